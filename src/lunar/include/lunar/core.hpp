@@ -13,6 +13,7 @@
 #include <lunar/device/video_device.hpp>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace lunar {
 
@@ -26,6 +27,17 @@ class CoreBase {
     virtual void SetInputDevice(InputDevice& device) = 0;
     virtual void SetVideoDevice(VideoDevice& device) = 0;
 
+    /* Reuses 2D scanlines whose registers and memory inputs did not change since the previous frame,
+     * which saves host CPU time on static screens. Disabled by default.
+     */
+    virtual void SetRenderMemoization(bool enable) = 0;
+
+    /* Skips 2D and 3D rendering of the frames that begin while enabled, e.g. for fast-forward.
+     * Skipped frames are not presented, but are emulated exactly like rendered frames.
+     * Frames that use display capture are always rendered, since the capture writes to VRAM.
+     */
+    virtual void SetSkipRendering(bool skip) = 0;
+
     virtual void Run(uint cycles) = 0;
 
     virtual void Load(std::string const& rom_path) = 0;
@@ -33,4 +45,10 @@ class CoreBase {
 
 auto CreateCore() -> std::unique_ptr<CoreBase>;
 
+/* Configures the threads that are used for rendering (shared by all cores).
+ * By default one thread per host CPU core minus one is used.
+ * Worker i is pinned to the host CPU cpu_affinity[i % cpu_affinity.size()], if given.
+ */
+void ConfigureRenderThreads(int thread_count, std::vector<int> const& cpu_affinity = {});
+
 } // namespace lunar
@@ -18,8 +18,36 @@ class VideoDevice {
       OpenGL
     };
 
+    // Pixel formats of software-rendered images.
+    enum PixelFormat {
+      BGRA8888, //< 32-bit, 0xAARRGGBB
+      RGBA8888, //< 32-bit, 0xAABBGGRR
+      RGB565,   //< 16-bit, red in the upper bits
+      BGR555    //< 16-bit, native Nintendo DS format (red in the lower bits, bit 15 is set)
+    };
+
+    enum Screen {
+      Top,
+      Bottom
+    };
+
     virtual ~VideoDevice() = default;
 
+    // Format of the software-rendered images that are passed to Draw().
+    virtual auto GetPixelFormat() const -> PixelFormat {
+      return PixelFormat::BGRA8888;
+    }
+
+    /* Called at the start of every frame, once per screen. The device may return a 256x192 buffer in its pixel format,
+     * which the emulator then renders the frame into directly (from its render threads) and later passes to Draw().
+     * The buffer must stay valid until it has been passed to Draw(). nullptr selects the emulator's own buffers.
+     * Frames are passed to Draw() once they have been rendered, which may be up to a frame later,
+     * so up to three buffers per screen can be in use at the same time.
+     */
+    virtual auto AcquireFrameBuffer(Screen screen) -> void* {
+      return nullptr;
+    }
+
     virtual void Draw(
       ImageType top_image_type,
       void const* top_image,
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  #define LUNAR_SIMD_X86
+#endif
+
+namespace lunar {
+
+enum class SIMDLevel {
+  Scalar,
+  SSE41,
+  AVX2
+};
+
+// Returns the most capable instruction set extension that is supported by the host CPU.
+inline auto GetHostSIMDLevel() -> SIMDLevel {
+#if defined(LUNAR_SIMD_X86)
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx2")) {
+    return SIMDLevel::AVX2;
+  }
+
+  if (__builtin_cpu_supports("sse4.1")) {
+    return SIMDLevel::SSE41;
+  }
+#endif
+
+  return SIMDLevel::Scalar;
+}
+
+} // namespace lunar
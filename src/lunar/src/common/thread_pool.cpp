@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <atom/logger/logger.hpp>
+#include <atom/panic.hpp>
+#include <algorithm>
+
+#if defined(__linux__)
+  #include <pthread.h>
+  #include <sched.h>
+#endif
+
+#include "thread_pool.hpp"
+
+namespace lunar {
+
+// Pool and queue of the worker thread that is executing the current task, if any.
+static thread_local ThreadPool* g_current_pool = nullptr;
+static thread_local int g_current_worker = -1;
+
+ThreadPool::ThreadPool(int thread_count, std::vector<int> const& cpu_affinity) {
+  Start(thread_count, cpu_affinity);
+}
+
+ThreadPool::~ThreadPool() {
+  Stop();
+}
+
+auto ThreadPool::Shared() -> ThreadPool& {
+  static ThreadPool pool{};
+  return pool;
+}
+
+auto ThreadPool::GetDefaultThreadCount() -> int {
+  return std::max(1, (int)std::thread::hardware_concurrency() - 1);
+}
+
+void ThreadPool::Configure(int thread_count, std::vector<int> const& cpu_affinity) {
+  if (g_current_pool == this) {
+    ATOM_PANIC("ThreadPool: a task cannot reconfigure the pool that it is running on");
+  }
+
+  std::unique_lock lock{config_mutex};
+
+  Stop();
+  Start(thread_count, cpu_affinity);
+}
+
+void ThreadPool::Submit(Task task) {
+  if (g_current_pool == this) {
+    // Tasks submitted by one of our workers go to the worker's own queue.
+    // Workers stay alive while they run a task, so there is no need to lock the configuration.
+    Push(g_current_worker, std::move(task));
+  } else {
+    std::shared_lock lock{config_mutex};
+    Push(next_queue++ % workers.size(), std::move(task));
+  }
+
+  epoch++;
+  epoch.notify_one();
+}
+
+void ThreadPool::Push(int id, Task&& task) {
+  auto& worker = *workers[id];
+
+  pending_tasks++;
+
+  std::lock_guard lock{worker.queue_mutex};
+  worker.queue.push_back(std::move(task));
+}
+
+void ThreadPool::Start(int thread_count, std::vector<int> const& cpu_affinity) {
+  thread_count = std::max(thread_count, 1);
+
+  running = true;
+
+  for (int i = 0; i < thread_count; i++) {
+    workers.push_back(std::make_unique<Worker>());
+  }
+
+  this->thread_count = thread_count;
+
+  for (int i = 0; i < thread_count; i++) {
+    auto& thread = workers[i]->thread;
+
+    thread = std::thread{[this, i]() {
+      WorkerMain(i);
+    }};
+
+    if (!cpu_affinity.empty()) {
+#if defined(__linux__)
+      cpu_set_t cpu_set;
+      CPU_ZERO(&cpu_set);
+      CPU_SET(cpu_affinity[i % cpu_affinity.size()], &cpu_set);
+
+      if (pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set), &cpu_set) != 0) {
+        ATOM_WARN("ThreadPool: failed to pin worker {0} to CPU {1}", i, cpu_affinity[i % cpu_affinity.size()]);
+      }
+#else
+      ATOM_WARN("ThreadPool: setting the CPU affinity is not supported on this platform");
+#endif
+    }
+  }
+}
+
+void ThreadPool::Stop() {
+  // Workers quit once all outstanding tasks have been completed.
+  running = false;
+  epoch++;
+  epoch.notify_all();
+
+  for (auto& worker : workers) {
+    worker->thread.join();
+  }
+
+  workers.clear();
+}
+
+void ThreadPool::WorkerMain(int id) {
+  Task task;
+
+  g_current_pool = this;
+  g_current_worker = id;
+
+  while (true) {
+    u32 current_epoch = epoch;
+
+    if (TryPop(id, task) || TrySteal(id, task)) {
+      task();
+      task = {};
+
+      // Wake up the other workers if they are waiting to quit.
+      if (--pending_tasks == 0 && !running) {
+        epoch++;
+        epoch.notify_all();
+      }
+      continue;
+    }
+
+    if (!running && pending_tasks == 0) {
+      break;
+    }
+
+    epoch.wait(current_epoch);
+  }
+}
+
+bool ThreadPool::TryPop(int id, Task& task) {
+  auto& worker = *workers[id];
+  std::lock_guard lock{worker.queue_mutex};
+
+  if (worker.queue.empty()) {
+    return false;
+  }
+
+  // The owner takes the most recent task, which likely works on data that still is in its cache.
+  task = std::move(worker.queue.back());
+  worker.queue.pop_back();
+  return true;
+}
+
+bool ThreadPool::TrySteal(int id, Task& task) {
+  int worker_count = (int)workers.size();
+
+  for (int i = 1; i < worker_count; i++) {
+    auto& victim = *workers[(id + i) % worker_count];
+    std::lock_guard lock{victim.queue_mutex};
+
+    // Thieves take the oldest task, so that they contend less with the owner and don't starve old tasks.
+    if (!victim.queue.empty()) {
+      task = std::move(victim.queue.front());
+      victim.queue.pop_front();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+} // namespace lunar
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <atom/integer.hpp>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+namespace lunar {
+
+/* Pool of worker threads that rendering work (PPU scanlines, 3D bands) is submitted to.
+ * Every worker owns a task queue that it takes tasks from in LIFO order.
+ * Idle workers steal the oldest tasks from the queues of other workers.
+ */
+class ThreadPool {
+  public:
+    using Task = std::function<void()>;
+
+    ThreadPool(int thread_count = GetDefaultThreadCount(), std::vector<int> const& cpu_affinity = {});
+   ~ThreadPool();
+
+    // Process-wide pool that is shared between all emulator instances.
+    static auto Shared() -> ThreadPool&;
+
+    // One thread per host core, except for the core that runs the emulation itself.
+    static auto GetDefaultThreadCount() -> int;
+
+    /* Changes the number of worker threads and optionally pins them to host CPUs.
+     * Worker i is pinned to cpu_affinity[i % cpu_affinity.size()] (currently only supported on Linux).
+     * Tasks that already have been submitted are completed first, Submit() blocks until the new workers are running.
+     * Thus it must not be called from a task and callers of Submit() must not hold locks that tasks depend on.
+     */
+    void Configure(int thread_count, std::vector<int> const& cpu_affinity = {});
+
+    // Does not lock the configuration, so the result may be outdated by a concurrent call to Configure().
+    auto GetThreadCount() const -> int {
+      return thread_count;
+    }
+
+    void Submit(Task task);
+
+  private:
+    struct Worker {
+      std::deque<Task> queue;
+      std::mutex queue_mutex;
+      std::thread thread;
+    };
+
+    void Start(int thread_count, std::vector<int> const& cpu_affinity);
+    void Stop();
+    void Push(int id, Task&& task);
+    void WorkerMain(int id);
+    bool TryPop(int id, Task& task);
+    bool TrySteal(int id, Task& task);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    // Held exclusively while the workers are (re)created.
+    mutable std::shared_mutex config_mutex;
+
+    // Incremented on every submit, idle workers sleep on it.
+    std::atomic<u32> epoch = 0;
+
+    std::atomic_int thread_count = 0;
+    std::atomic_int pending_tasks = 0;
+    std::atomic_uint next_queue = 0;
+    std::atomic_bool running = false;
+};
+
+} // namespace lunar
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+
+namespace lunar {
+
+// Tells the CPU that we are in a spin loop (reduces power usage and SMT contention).
+inline void SpinPause() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+  asm volatile("yield");
+#endif
+}
+
+/* Waits for an atomic value to satisfy a condition.
+ * Most waits are very short, so we first spin for a little while before going to sleep with std::atomic::wait().
+ * The spin budget adapts to how often spinning was successful in the past.
+ * Each instance should only be used by a single thread.
+ */
+class AdaptiveWaiter {
+  public:
+    template<typename T, typename Predicate>
+    auto Wait(std::atomic<T> const& atomic, Predicate&& predicate) -> T {
+      T value = atomic.load();
+
+      for (int i = 0; i < spin_limit; i++) {
+        if (predicate(value)) {
+          spin_limit = std::min(spin_limit * 2, kMaxSpinLimit);
+          return value;
+        }
+        SpinPause();
+        value = atomic.load();
+      }
+
+      while (!predicate(value)) {
+        atomic.wait(value);
+        value = atomic.load();
+      }
+
+      spin_limit = std::max(spin_limit / 2, kMinSpinLimit);
+      return value;
+    }
+
+  private:
+    static constexpr int kMinSpinLimit = 16;
+    static constexpr int kMaxSpinLimit = 4096;
+
+    int spin_limit = kMinSpinLimit;
+};
+
+} // namespace lunar
@@ -14,7 +14,8 @@ namespace lunar::nds {
 ARM9::ARM9(Interconnect& interconnect)
     : bus(&interconnect)
     , cp15(&bus)
-    , irq(interconnect.irq9) {
+    , irq(interconnect.irq9)
+    , gpu(interconnect.video_unit.gpu) {
   auto cpu_descriptor = lunatic::CPU::Descriptor{
     .memory = bus,
     .coprocessors = {
@@ -54,6 +55,11 @@ void ARM9::Reset(u32 entrypoint) {
 }
 
 void ARM9::Run(uint cycles) {
+  // The CPU waits for the GXFIFO to accept its last write.
+  if (gpu.IsStallingCPU()) {
+    return;
+  }
+
   core->Run(cycles);
 }
 
@@ -21,7 +21,7 @@ class ARM9 {
 
     void Reset(u32 entrypoint);
     auto Bus() -> ARM9MemoryBus& { return bus; }
-    bool IsHalted() { return core->WaitForIRQ(); }
+    bool IsHalted() { return core->WaitForIRQ() || gpu.IsStallingCPU(); }
     void Run(uint cycles);
 
   private:
@@ -29,6 +29,7 @@ class ARM9 {
     CP15 cp15;
     std::unique_ptr<lunatic::CPU> core;
     IRQ& irq;
+    GPU const& gpu;
 };
 
 } // namespace lunar::nds
@@ -145,6 +145,9 @@ auto ARM9MemoryBus::Read(u32 address, Bus bus) -> T {
       return atom::read<T>(video_unit.pram, address & 0x7FF);
     }
     case 0x06: {
+      if (address >= 0x06800000) {
+        video_unit.ppu_a.OnAccessVRAM_LCDC(vram.region_lcdc, address & 0xFFFFF);
+      }
       return VisitVRAMByAddress<ReadFunctor<T>>(address);
     }
     case 0x07: {
@@ -231,6 +234,10 @@ void ARM9MemoryBus::Write(u32 address, T value, Bus bus) {
       break;
     }
     case 0x06: {
+      if (address >= 0x06800000) {
+        video_unit.ppu_a.OnAccessVRAM_LCDC(vram.region_lcdc, address & 0xFFFFF);
+      }
+
       VisitVRAMByAddress<WriteFunctor<T>>(address, value);
 
       // TODO: do this properly and remove template abuse.
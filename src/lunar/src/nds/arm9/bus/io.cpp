@@ -191,6 +191,10 @@ enum Registers {
   REG_GXCMDPORT_LO = 0x0400'0440,
   REG_GXCMDPORT_HI = 0x0400'05C8,
   REG_GXSTAT = 0x0400'0600,
+  REG_POS_RESULT_LO = 0x0400'0620,
+  REG_POS_RESULT_HI = 0x0400'062F,
+  REG_VEC_RESULT_LO = 0x0400'0630,
+  REG_VEC_RESULT_HI = 0x0400'0635,
   REG_CLIPMTX_RESULT_LO = 0x0400'0640,
   REG_CLIPMTX_RESULT_HI = 0x0400'067F
 };
@@ -689,6 +693,10 @@ auto ARM9MemoryBus::ReadByteIO(u32 address) -> u8 {
       return gpu_io.gxstat.ReadByte(2);
     case REG_GXSTAT|3:
       return gpu_io.gxstat.ReadByte(3);
+    case REG_POS_RESULT_LO ... REG_POS_RESULT_HI:
+      return gpu_io.ReadPositionResult<u8>(address - REG_POS_RESULT_LO);
+    case REG_VEC_RESULT_LO ... REG_VEC_RESULT_HI:
+      return gpu_io.ReadVectorResult<u8>(address - REG_VEC_RESULT_LO);
     case REG_CLIPMTX_RESULT_LO ... REG_CLIPMTX_RESULT_HI:
       return gpu_io.ReadClipMatrix<u8>(address - REG_CLIPMTX_RESULT_LO);
 
@@ -710,6 +718,10 @@ auto ARM9MemoryBus::ReadHalfIO(u32 address) -> u16 {
       return ipc.ipcfiforecv.ReadHalf(IPC::Client::ARM9, 0);
     case REG_IPCFIFORECV|2:
       return ipc.ipcfiforecv.ReadHalf(IPC::Client::ARM9, 2);
+    case REG_POS_RESULT_LO ... REG_POS_RESULT_HI:
+      return gpu_io.ReadPositionResult<u16>(address - REG_POS_RESULT_LO);
+    case REG_VEC_RESULT_LO ... REG_VEC_RESULT_HI:
+      return gpu_io.ReadVectorResult<u16>(address - REG_VEC_RESULT_LO);
     case REG_CLIPMTX_RESULT_LO ... REG_CLIPMTX_RESULT_HI:
       return gpu_io.ReadClipMatrix<u16>(address - REG_CLIPMTX_RESULT_LO);
   }
@@ -726,6 +738,10 @@ auto ARM9MemoryBus::ReadWordIO(u32 address) -> u32 {
       return ipc.ipcfiforecv.ReadWord(IPC::Client::ARM9);
     case REG_CARDDATA:
       return cart.ReadROM();
+    case REG_POS_RESULT_LO ... REG_POS_RESULT_HI:
+      return gpu_io.ReadPositionResult<u32>(address - REG_POS_RESULT_LO);
+    case REG_VEC_RESULT_LO ... REG_VEC_RESULT_HI:
+      return gpu_io.ReadVectorResult<u32>(address - REG_VEC_RESULT_LO);
     case REG_CLIPMTX_RESULT_LO ... REG_CLIPMTX_RESULT_HI:
       return gpu_io.ReadClipMatrix<u32>(address - REG_CLIPMTX_RESULT_LO);
   }
@@ -738,257 +754,20 @@ auto ARM9MemoryBus::ReadWordIO(u32 address) -> u32 {
 
 void ARM9MemoryBus::WriteByteIO(u32 address,  u8 value) {
   auto& gpu_io = video_unit.gpu;
-  auto& ppu_io_a = video_unit.ppu_a.mmio;
-  auto& ppu_io_b = video_unit.ppu_b.mmio;
+  auto& ppu_a = video_unit.ppu_a;
+  auto& ppu_b = video_unit.ppu_b;
 
   switch (address) {
     // PPU engine A
-    case REG_DISPCNT_A|0:
-      ppu_io_a.dispcnt.WriteByte(0, value);
-      break;
-    case REG_DISPCNT_A|1:
-      ppu_io_a.dispcnt.WriteByte(1, value);
-      break;
-    case REG_DISPCNT_A|2:
-      ppu_io_a.dispcnt.WriteByte(2, value);
-      break;
-    case REG_DISPCNT_A|3:
-      ppu_io_a.dispcnt.WriteByte(3, value);
-      break;
     case REG_DISPSTAT|0:
       video_unit.dispstat9.WriteByte(0, value);
       break;
     case REG_DISPSTAT|1:
       video_unit.dispstat9.WriteByte(1, value);
       break;
-    case REG_BG0CNT_A|0:
-      ppu_io_a.bgcnt[0].WriteByte(0, value);
-      break;
-    case REG_BG0CNT_A|1:
-      ppu_io_a.bgcnt[0].WriteByte(1, value);
-      break;
-    case REG_BG1CNT_A|0:
-      ppu_io_a.bgcnt[1].WriteByte(0, value);
-      break;
-    case REG_BG1CNT_A|1:
-      ppu_io_a.bgcnt[1].WriteByte(1, value);
-      break;
-    case REG_BG2CNT_A|0:
-      ppu_io_a.bgcnt[2].WriteByte(0, value);
-      break;
-    case REG_BG2CNT_A|1:
-      ppu_io_a.bgcnt[2].WriteByte(1, value);
-      break;
-    case REG_BG3CNT_A|0:
-      ppu_io_a.bgcnt[3].WriteByte(0, value);
-      break;
-    case REG_BG3CNT_A|1:
-      ppu_io_a.bgcnt[3].WriteByte(1, value);
-      break;
-    case REG_BG0HOFS_A|0:
-      ppu_io_a.bghofs[0].WriteByte(0, value);
-      break;
-    case REG_BG0HOFS_A|1:
-      ppu_io_a.bghofs[0].WriteByte(1, value);
-      break;
-    case REG_BG0VOFS_A|0:
-      ppu_io_a.bgvofs[0].WriteByte(0, value);
-      break;
-    case REG_BG0VOFS_A|1:
-      ppu_io_a.bgvofs[0].WriteByte(1, value);
-      break;
-    case REG_BG1HOFS_A|0:
-      ppu_io_a.bghofs[1].WriteByte(0, value);
-      break;
-    case REG_BG1HOFS_A|1:
-      ppu_io_a.bghofs[1].WriteByte(1, value);
-      break;
-    case REG_BG1VOFS_A|0:
-      ppu_io_a.bgvofs[1].WriteByte(0, value);
-      break;
-    case REG_BG1VOFS_A|1:
-      ppu_io_a.bgvofs[1].WriteByte(1, value);
-      break;
-    case REG_BG2HOFS_A|0:
-      ppu_io_a.bghofs[2].WriteByte(0, value);
-      break;
-    case REG_BG2HOFS_A|1:
-      ppu_io_a.bghofs[2].WriteByte(1, value);
-      break;
-    case REG_BG2VOFS_A|0:
-      ppu_io_a.bgvofs[2].WriteByte(0, value);
-      break;
-    case REG_BG2VOFS_A|1:
-      ppu_io_a.bgvofs[2].WriteByte(1, value);
-      break;
-    case REG_BG3HOFS_A|0:
-      ppu_io_a.bghofs[3].WriteByte(0, value);
-      break;
-    case REG_BG3HOFS_A|1:
-      ppu_io_a.bghofs[3].WriteByte(1, value);
-      break;
-    case REG_BG3VOFS_A|0:
-      ppu_io_a.bgvofs[3].WriteByte(0, value);
-      break;
-    case REG_BG3VOFS_A|1:
-      ppu_io_a.bgvofs[3].WriteByte(1, value);
-      break;    
-    case REG_BG2PA_A|0:
-      ppu_io_a.bgpa[0].WriteByte(0, value);
-      break;
-    case REG_BG2PA_A|1:
-      ppu_io_a.bgpa[0].WriteByte(1, value);
-      break;
-    case REG_BG2PB_A|0:
-      ppu_io_a.bgpb[0].WriteByte(0, value);
-      break;
-    case REG_BG2PB_A|1:
-      ppu_io_a.bgpb[0].WriteByte(1, value);
-      break;
-    case REG_BG2PC_A|0:
-      ppu_io_a.bgpc[0].WriteByte(0, value);
-      break;
-    case REG_BG2PC_A|1:
-      ppu_io_a.bgpc[0].WriteByte(1, value);
-      break;
-    case REG_BG2PD_A|0:
-      ppu_io_a.bgpd[0].WriteByte(0, value);
-      break;
-    case REG_BG2PD_A|1:
-      ppu_io_a.bgpd[0].WriteByte(1, value);
-      break;
-    case REG_BG2X_A|0:
-      ppu_io_a.bgx[0].WriteByte(0, value);
-      break;
-    case REG_BG2X_A|1:
-      ppu_io_a.bgx[0].WriteByte(1, value);
-      break;
-    case REG_BG2X_A|2:
-      ppu_io_a.bgx[0].WriteByte(2, value);
-      break;
-    case REG_BG2X_A|3:
-      ppu_io_a.bgx[0].WriteByte(3, value);
-      break;
-    case REG_BG2Y_A|0:
-      ppu_io_a.bgy[0].WriteByte(0, value);
-      break;
-    case REG_BG2Y_A|1:
-      ppu_io_a.bgy[0].WriteByte(1, value);
-      break;
-    case REG_BG2Y_A|2:
-      ppu_io_a.bgy[0].WriteByte(2, value);
-      break;
-    case REG_BG2Y_A|3:
-      ppu_io_a.bgy[0].WriteByte(3, value);
-      break;
-    case REG_BG3PA_A|0:
-      ppu_io_a.bgpa[1].WriteByte(0, value);
-      break;
-    case REG_BG3PA_A|1:
-      ppu_io_a.bgpa[1].WriteByte(1, value);
-      break;
-    case REG_BG3PB_A|0:
-      ppu_io_a.bgpb[1].WriteByte(0, value);
-      break;
-    case REG_BG3PB_A|1:
-      ppu_io_a.bgpb[1].WriteByte(1, value);
-      break;
-    case REG_BG3PC_A|0:
-      ppu_io_a.bgpc[1].WriteByte(0, value);
-      break;
-    case REG_BG3PC_A|1:
-      ppu_io_a.bgpc[1].WriteByte(1, value);
-      break;
-    case REG_BG3PD_A|0:
-      ppu_io_a.bgpd[1].WriteByte(0, value);
-      break;
-    case REG_BG3PD_A|1:
-      ppu_io_a.bgpd[1].WriteByte(1, value);
-      break;
-    case REG_BG3X_A|0:
-      ppu_io_a.bgx[1].WriteByte(0, value);
-      break;
-    case REG_BG3X_A|1:
-      ppu_io_a.bgx[1].WriteByte(1, value);
-      break;
-    case REG_BG3X_A|2:
-      ppu_io_a.bgx[1].WriteByte(2, value);
-      break;
-    case REG_BG3X_A|3:
-      ppu_io_a.bgx[1].WriteByte(3, value);
-      break;
-    case REG_BG3Y_A|0:
-      ppu_io_a.bgy[1].WriteByte(0, value);
-      break;
-    case REG_BG3Y_A|1:
-      ppu_io_a.bgy[1].WriteByte(1, value);
-      break;
-    case REG_BG3Y_A|2:
-      ppu_io_a.bgy[1].WriteByte(2, value);
-      break;
-    case REG_BG3Y_A|3:
-      ppu_io_a.bgy[1].WriteByte(3, value);
-      break;
-    case REG_WIN0H_A|0:
-      ppu_io_a.winh[0].WriteByte(0, value);
-      break;
-    case REG_WIN0H_A|1:
-      ppu_io_a.winh[0].WriteByte(1, value);
-      break;
-    case REG_WIN1H_A|0:
-      ppu_io_a.winh[1].WriteByte(0, value);
-      break;
-    case REG_WIN1H_A|1:
-      ppu_io_a.winh[1].WriteByte(1, value);
-      break;
-    case REG_WIN0V_A|0:
-      ppu_io_a.winv[0].WriteByte(0, value);
-      break;
-    case REG_WIN0V_A|1:
-      ppu_io_a.winv[0].WriteByte(1, value);
-      break;
-    case REG_WIN1V_A|0:
-      ppu_io_a.winv[1].WriteByte(0, value);
-      break;
-    case REG_WIN1V_A|1:
-      ppu_io_a.winv[1].WriteByte(1, value);
-      break;
-    case REG_WININ_A|0:
-      ppu_io_a.winin.WriteByte(0, value);
-      break;
-    case REG_WININ_A|1:
-      ppu_io_a.winin.WriteByte(1, value);
-      break;
-    case REG_WINOUT_A|0:
-      ppu_io_a.winout.WriteByte(0, value);
-      break;
-    case REG_WINOUT_A|1:
-      ppu_io_a.winout.WriteByte(1, value);
-      break;
-    case REG_MOSAIC_A|0:
-      ppu_io_a.mosaic.WriteByte(0, value);
-      break;
-    case REG_MOSAIC_A|1:
-      ppu_io_a.mosaic.WriteByte(1, value);
-      break;
     case REG_MOSAIC_A|2:
     case REG_MOSAIC_A|3:
       break;
-    case REG_BLDCNT_A|0:
-      ppu_io_a.bldcnt.WriteByte(0, value);
-      break;
-    case REG_BLDCNT_A|1:
-      ppu_io_a.bldcnt.WriteByte(1, value);
-      break;
-    case REG_BLDALPHA_A|0:
-      ppu_io_a.bldalpha.WriteByte(0, value);
-      break;
-    case REG_BLDALPHA_A|1:
-      ppu_io_a.bldalpha.WriteByte(1, value);
-      break;
-    case REG_BLDY_A|0:
-      ppu_io_a.bldy.WriteByte(0, value);
-      break;
     case REG_BLDY_A|1:
     case REG_BLDY_A|2:
     case REG_BLDY_A|3:
@@ -1005,263 +784,26 @@ void ARM9MemoryBus::WriteByteIO(u32 address,  u8 value) {
     case REG_DISPCAPCNT|3:
       video_unit.dispcapcnt.WriteByte(3, value);
       break;
-    case REG_MASTER_BRIGHT_A|0:
-      ppu_io_a.master_bright.WriteByte(0, value);
-      break;
-    case REG_MASTER_BRIGHT_A|1:
-      ppu_io_a.master_bright.WriteByte(1, value);
+    case REG_DISPCNT_A ... REG_DISPCNT_A|3:
+    case REG_BG0CNT_A ... REG_MOSAIC_A|1:
+    case REG_BLDCNT_A ... REG_BLDY_A:
+    case REG_MASTER_BRIGHT_A ... REG_MASTER_BRIGHT_A|1:
+      ppu_a.WriteRegister(address & 0xFF, value);
       break;
 
     // PPU engine B
-    case REG_DISPCNT_B|0:
-      ppu_io_b.dispcnt.WriteByte(0, value);
-      break;
-    case REG_DISPCNT_B|1:
-      ppu_io_b.dispcnt.WriteByte(1, value);
-      break;
-    case REG_DISPCNT_B|2:
-      ppu_io_b.dispcnt.WriteByte(2, value);
-      break;
-    case REG_DISPCNT_B|3:
-      ppu_io_b.dispcnt.WriteByte(3, value);
-      break;
-    case REG_BG0CNT_B|0:
-      ppu_io_b.bgcnt[0].WriteByte(0, value);
-      break;
-    case REG_BG0CNT_B|1:
-      ppu_io_b.bgcnt[0].WriteByte(1, value);
-      break;
-    case REG_BG1CNT_B|0:
-      ppu_io_b.bgcnt[1].WriteByte(0, value);
-      break;
-    case REG_BG1CNT_B|1:
-      ppu_io_b.bgcnt[1].WriteByte(1, value);
-      break;
-    case REG_BG2CNT_B|0:
-      ppu_io_b.bgcnt[2].WriteByte(0, value);
-      break;
-    case REG_BG2CNT_B|1:
-      ppu_io_b.bgcnt[2].WriteByte(1, value);
-      break;
-    case REG_BG3CNT_B|0:
-      ppu_io_b.bgcnt[3].WriteByte(0, value);
-      break;
-    case REG_BG3CNT_B|1:
-      ppu_io_b.bgcnt[3].WriteByte(1, value);
-      break;
-    case REG_BG0HOFS_B|0:
-      ppu_io_b.bghofs[0].WriteByte(0, value);
-      break;
-    case REG_BG0HOFS_B|1:
-      ppu_io_b.bghofs[0].WriteByte(1, value);
-      break;
-    case REG_BG0VOFS_B|0:
-      ppu_io_b.bgvofs[0].WriteByte(0, value);
-      break;
-    case REG_BG0VOFS_B|1:
-      ppu_io_b.bgvofs[0].WriteByte(1, value);
-      break;
-    case REG_BG1HOFS_B|0:
-      ppu_io_b.bghofs[1].WriteByte(0, value);
-      break;
-    case REG_BG1HOFS_B|1:
-      ppu_io_b.bghofs[1].WriteByte(1, value);
-      break;
-    case REG_BG1VOFS_B|0:
-      ppu_io_b.bgvofs[1].WriteByte(0, value);
-      break;
-    case REG_BG1VOFS_B|1:
-      ppu_io_b.bgvofs[1].WriteByte(1, value);
-      break;
-    case REG_BG2HOFS_B|0:
-      ppu_io_b.bghofs[2].WriteByte(0, value);
-      break;
-    case REG_BG2HOFS_B|1:
-      ppu_io_b.bghofs[2].WriteByte(1, value);
-      break;
-    case REG_BG2VOFS_B|0:
-      ppu_io_b.bgvofs[2].WriteByte(0, value);
-      break;
-    case REG_BG2VOFS_B|1:
-      ppu_io_b.bgvofs[2].WriteByte(1, value);
-      break;
-    case REG_BG3HOFS_B|0:
-      ppu_io_b.bghofs[3].WriteByte(0, value);
-      break;
-    case REG_BG3HOFS_B|1:
-      ppu_io_b.bghofs[3].WriteByte(1, value);
-      break;
-    case REG_BG3VOFS_B|0:
-      ppu_io_b.bgvofs[3].WriteByte(0, value);
-      break;
-    case REG_BG3VOFS_B|1:
-      ppu_io_b.bgvofs[3].WriteByte(1, value);
-      break;
-    case REG_BG2PA_B|0:
-      ppu_io_b.bgpa[0].WriteByte(0, value);
-      break;
-    case REG_BG2PA_B|1:
-      ppu_io_b.bgpa[0].WriteByte(1, value);
-      break;
-    case REG_BG2PB_B|0:
-      ppu_io_b.bgpb[0].WriteByte(0, value);
-      break;
-    case REG_BG2PB_B|1:
-      ppu_io_b.bgpb[0].WriteByte(1, value);
-      break;
-    case REG_BG2PC_B|0:
-      ppu_io_b.bgpc[0].WriteByte(0, value);
-      break;
-    case REG_BG2PC_B|1:
-      ppu_io_b.bgpc[0].WriteByte(1, value);
-      break;
-    case REG_BG2PD_B|0:
-      ppu_io_b.bgpd[0].WriteByte(0, value);
-      break;
-    case REG_BG2PD_B|1:
-      ppu_io_b.bgpd[0].WriteByte(1, value);
-      break;
-    case REG_BG2X_B|0:
-      ppu_io_b.bgx[0].WriteByte(0, value);
-      break;
-    case REG_BG2X_B|1:
-      ppu_io_b.bgx[0].WriteByte(1, value);
-      break;
-    case REG_BG2X_B|2:
-      ppu_io_b.bgx[0].WriteByte(2, value);
-      break;
-    case REG_BG2X_B|3:
-      ppu_io_b.bgx[0].WriteByte(3, value);
-      break;
-    case REG_BG2Y_B|0:
-      ppu_io_b.bgy[0].WriteByte(0, value);
-      break;
-    case REG_BG2Y_B|1:
-      ppu_io_b.bgy[0].WriteByte(1, value);
-      break;
-    case REG_BG2Y_B|2:
-      ppu_io_b.bgy[0].WriteByte(2, value);
-      break;
-    case REG_BG2Y_B|3:
-      ppu_io_b.bgy[0].WriteByte(3, value);
-      break;
-    case REG_BG3PA_B|0:
-      ppu_io_b.bgpa[1].WriteByte(0, value);
-      break;
-    case REG_BG3PA_B|1:
-      ppu_io_b.bgpa[1].WriteByte(1, value);
-      break;
-    case REG_BG3PB_B|0:
-      ppu_io_b.bgpb[1].WriteByte(0, value);
-      break;
-    case REG_BG3PB_B|1:
-      ppu_io_b.bgpb[1].WriteByte(1, value);
-      break;
-    case REG_BG3PC_B|0:
-      ppu_io_b.bgpc[1].WriteByte(0, value);
-      break;
-    case REG_BG3PC_B|1:
-      ppu_io_b.bgpc[1].WriteByte(1, value);
-      break;
-    case REG_BG3PD_B|0:
-      ppu_io_b.bgpd[1].WriteByte(0, value);
-      break;
-    case REG_BG3PD_B|1:
-      ppu_io_b.bgpd[1].WriteByte(1, value);
-      break;
-    case REG_BG3X_B|0:
-      ppu_io_b.bgx[1].WriteByte(0, value);
-      break;
-    case REG_BG3X_B|1:
-      ppu_io_b.bgx[1].WriteByte(1, value);
-      break;
-    case REG_BG3X_B|2:
-      ppu_io_b.bgx[1].WriteByte(2, value);
-      break;
-    case REG_BG3X_B|3:
-      ppu_io_b.bgx[1].WriteByte(3, value);
-      break;
-    case REG_BG3Y_B|0:
-      ppu_io_b.bgy[1].WriteByte(0, value);
-      break;
-    case REG_BG3Y_B|1:
-      ppu_io_b.bgy[1].WriteByte(1, value);
-      break;
-    case REG_BG3Y_B|2:
-      ppu_io_b.bgy[1].WriteByte(2, value);
-      break;
-    case REG_BG3Y_B|3:
-      ppu_io_b.bgy[1].WriteByte(3, value);
-      break;
-    case REG_WIN0H_B|0:
-      ppu_io_b.winh[0].WriteByte(0, value);
-      break;
-    case REG_WIN0H_B|1:
-      ppu_io_b.winh[0].WriteByte(1, value);
-      break;
-    case REG_WIN1H_B|0:
-      ppu_io_b.winh[1].WriteByte(0, value);
-      break;
-    case REG_WIN1H_B|1:
-      ppu_io_b.winh[1].WriteByte(1, value);
-      break;
-    case REG_WIN0V_B|0:
-      ppu_io_b.winv[0].WriteByte(0, value);
-      break;
-    case REG_WIN0V_B|1:
-      ppu_io_b.winv[0].WriteByte(1, value);
-      break;
-    case REG_WIN1V_B|0:
-      ppu_io_b.winv[1].WriteByte(0, value);
-      break;
-    case REG_WIN1V_B|1:
-      ppu_io_b.winv[1].WriteByte(1, value);
-      break;
-    case REG_WININ_B|0:
-      ppu_io_b.winin.WriteByte(0, value);
-      break;
-    case REG_WININ_B|1:
-      ppu_io_b.winin.WriteByte(1, value);
-      break;
-    case REG_WINOUT_B|0:
-      ppu_io_b.winout.WriteByte(0, value);
-      break;
-    case REG_WINOUT_B|1:
-      ppu_io_b.winout.WriteByte(1, value);
-      break;
-    case REG_MOSAIC_B|0:
-      ppu_io_b.mosaic.WriteByte(0, value);
-      break;
-    case REG_MOSAIC_B|1:
-      ppu_io_b.mosaic.WriteByte(1, value);
-      break;
     case REG_MOSAIC_B|2:
     case REG_MOSAIC_B|3:
       break;
-    case REG_BLDCNT_B|0:
-      ppu_io_b.bldcnt.WriteByte(0, value);
-      break;
-    case REG_BLDCNT_B|1:
-      ppu_io_b.bldcnt.WriteByte(1, value);
-      break;
-    case REG_BLDALPHA_B|0:
-      ppu_io_b.bldalpha.WriteByte(0, value);
-      break;
-    case REG_BLDALPHA_B|1:
-      ppu_io_b.bldalpha.WriteByte(1, value);
-      break;
-    case REG_BLDY_B|0:
-      ppu_io_b.bldy.WriteByte(0, value);
-      break;
     case REG_BLDY_B|1:
     case REG_BLDY_B|2:
     case REG_BLDY_B|3:
       break;
-    case REG_MASTER_BRIGHT_B|0:
-      ppu_io_b.master_bright.WriteByte(0, value);
-      break;
-    case REG_MASTER_BRIGHT_B|1:
-      ppu_io_b.master_bright.WriteByte(1, value);
+    case REG_DISPCNT_B ... REG_DISPCNT_B|3:
+    case REG_BG0CNT_B ... REG_MOSAIC_B|1:
+    case REG_BLDCNT_B ... REG_BLDY_B:
+    case REG_MASTER_BRIGHT_B ... REG_MASTER_BRIGHT_B|1:
+      ppu_b.WriteRegister(address & 0xFF, value);
       break;
 
     // DMA
@@ -1626,15 +1168,20 @@ void ARM9MemoryBus::WriteByteIO(u32 address,  u8 value) {
       exmemcnt.WriteByte(1, value);
       break;
     case REG_VRAMCNT_A:
+      // Display capture only writes to banks A to D. Pending captures go to the banks that are mapped before the write.
+      video_unit.ppu_a.WriteBackDisplayCapture(vram.region_lcdc, true);
       vram.vramcnt_a.WriteByte(value);
       break;
     case REG_VRAMCNT_B:
+      video_unit.ppu_a.WriteBackDisplayCapture(vram.region_lcdc, true);
       vram.vramcnt_b.WriteByte(value);
       break;
     case REG_VRAMCNT_C:
+      video_unit.ppu_a.WriteBackDisplayCapture(vram.region_lcdc, true);
       vram.vramcnt_c.WriteByte(value);
       break;
     case REG_VRAMCNT_D:
+      video_unit.ppu_a.WriteBackDisplayCapture(vram.region_lcdc, true);
       vram.vramcnt_d.WriteByte(value);
       break;
     case REG_VRAMCNT_E:
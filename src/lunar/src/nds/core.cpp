@@ -11,6 +11,7 @@
 #include "arm9/arm9.hpp"
 #include "interconnect.hpp"
 #include "buildconfig.hpp"
+#include "common/thread_pool.hpp"
 
 namespace lunar::nds {
 
@@ -53,6 +54,14 @@ class Core final : public CoreBase {
       interconnect.video_unit.SetVideoDevice(device);
     }
 
+    void SetRenderMemoization(bool enable) override {
+      interconnect.video_unit.SetRenderMemoization(enable);
+    }
+
+    void SetSkipRendering(bool skip) override {
+      interconnect.video_unit.SetSkipRendering(skip);
+    }
+
     void Run(uint cycles) override {
       auto& scheduler = interconnect.scheduler;
       auto& irq9 = interconnect.irq9;
@@ -168,6 +177,9 @@ class Core final : public CoreBase {
       // Set POSTFLG=1
       arm7.Bus().WriteByte(0x04000300, 1, Bus::Data);
       arm9.Bus().WriteByte(0x04000300, 1, Bus::Data);
+
+      // The firmware leaves all graphics engines powered on, with engine A on the top screen.
+      arm9.Bus().WriteHalf(0x04000304, 0x820F, Bus::Data);
     }
 
     void FirmwareBoot() {
@@ -191,4 +203,8 @@ auto CreateCore() -> std::unique_ptr<CoreBase> {
   return std::make_unique<nds::Core>();
 }
 
+void ConfigureRenderThreads(int thread_count, std::vector<int> const& cpu_affinity) {
+  ThreadPool::Shared().Configure(thread_count, cpu_affinity);
+}
+
 } // namespace lunar
@@ -24,6 +24,21 @@ static constexpr int kCmdNumParams[256] {
   3, 2, 1                                              // 0x70 - 0x7F (Box, position and vector test)
 };
 
+// Execution time of each command in (33 MHz) cycles, not counting the additional cost of simultaneous matrix mode and lighting.
+static constexpr int kCmdCycles[256] {
+  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 0, 0, // 0x00 - 0x0F (all NOPs)
+  1, 17, 36, 17, 36, 19, 34, 30, 35, 31, 28, 22, 22,  0, 0, 0, // 0x10 - 0x1F (Matrix engine)
+  1,  9,  1,  9,  8,  8,  8,  8,  8,  1,  1,  1,  0,  0, 0, 0, // 0x20 - 0x2F (Vertex and polygon attributes, mostly)
+  4,  4,  6,  1, 32,  0,  0,  0,  0,  0,  0,  0,  0,  0, 0, 0, // 0x30 - 0x3F (Material / lighting properties)
+  1,  1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 0, 0, // 0x40 - 0x4F (Begin/end vertex)
+392,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 0, 0, // 0x50 - 0x5F (Swap buffers)
+  1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 0, 0, // 0x60 - 0x6F (Set viewport)
+103,  9,  5                                                    // 0x70 - 0x7F (Box, position and vector test)
+};
+
+// Number of cycles that may be spent executing commands before the scheduler regains control.
+static constexpr int kCmdBatchCycles = 512;
+
 void GPU::WriteGXFIFO(u32 value) {
   u8 command;
 
@@ -75,9 +90,26 @@ void GPU::Enqueue(CmdArgPack pack) {
      * but this is difficult to emulate accurately.
      */
     while (gxfifo.IsFull()) {
+      if (swap_buffers_pending) {
+        /* The geometry engine is halted until the buffers are swapped at V-blank, so the write stalls the CPU until then.
+         * The entry is held back in gxfifo_stall and the ARM9 does not run while it isn't empty, see IsStallingCPU().
+         */
+        if (!gxfifo_stall.IsFull()) {
+          gxfifo_stall.Write(pack);
+          return;
+        }
+
+        /* Only writes that happen before the ARM9 stops (at the end of its time slice) or by DMA end up here.
+         * If there are too many of them, swap the buffers early instead. This is visible to the game, but rare.
+         */
+        SwapBuffers();
+        continue;
+      }
+
       gxstat.gx_busy = false;
       if (cmd_event != nullptr) {
         scheduler.Cancel(cmd_event);
+        cmd_event = nullptr;
       }
       ProcessCommands();
     }
@@ -97,6 +129,12 @@ auto GPU::Dequeue() -> CmdArgPack {
   auto entry = gxpipe.Read();
   if (gxpipe.Count() <= 2 && !gxfifo.IsEmpty()) {
     gxpipe.Write(gxfifo.Read());
+
+    // Entries are only held back while the GXFIFO is full, so the free slot is taken by the oldest one.
+    if (!gxfifo_stall.IsEmpty()) {
+      gxfifo.Write(gxfifo_stall.Read());
+    }
+
     CheckGXFIFO_IRQ();
 
     if (gxfifo.Count() < 128) {
@@ -111,16 +149,36 @@ auto GPU::Dequeue() -> CmdArgPack {
 }
 
 void GPU::ProcessCommands() {
-  auto count = gxpipe.Count() + gxfifo.Count();
-
-  if (count == 0 || gxstat.gx_busy) {
+  // SwapBuffers() resumes command processing once the buffers have been swapped.
+  if (gxstat.gx_busy || swap_buffers_pending) {
     return;
   }
 
-  auto command = gxpipe.Peek().command;
-  auto arg_count = kCmdNumParams[command];
+  /* Execute as many commands as fit into the cycle budget in one go and signal
+   * completion once their accumulated execution time has elapsed.
+   * GXSTAT reports the geometry engine as busy until then. This also prevents
+   * GXFIFO DMA transfers triggered from Dequeue() from re-entering here.
+   */
+  int cycles = 0;
+
+  gxstat.gx_busy = true;
+
+  while (true) {
+    auto count = gxpipe.Count() + gxfifo.Count();
+
+    if (count == 0) {
+      break;
+    }
+
+    auto command = gxpipe.Peek().command;
+    auto arg_count = kCmdNumParams[command];
+
+    if (count < arg_count) {
+      break;
+    }
+
+    cycles += GetCommandCycles(command);
 
-  if (count >= arg_count) {
     switch (command) {
       case 0x10: CMD_SetMatrixMode(); break;
       case 0x11: CMD_PushMatrix(); break;
@@ -154,6 +212,9 @@ void GPU::ProcessCommands() {
       case 0x40: CMD_BeginVertexList(); break;
       case 0x41: CMD_EndVertexList(); break;
       case 0x50: CMD_SwapBuffers(); break;
+      case 0x70: CMD_BoxTest(); break;
+      case 0x71: CMD_PositionTest(); break;
+      case 0x72: CMD_VectorTest(); break;
       default: {
         ATOM_ERROR("GPU: unimplemented command 0x{0:02X}", command);
         Dequeue();
@@ -163,16 +224,53 @@ void GPU::ProcessCommands() {
       }
     }
 
-    if (!swap_buffers_pending) {
-      // TODO: scheduling a bunch of events with 1 cycle delay might be a tad slow.
-      gxstat.gx_busy = true;
-      cmd_event = scheduler.Add(1, [this](int cycles_late) {
-        gxstat.gx_busy = false;
-        cmd_event = nullptr;
-        ProcessCommands();
-      });
+    if (swap_buffers_pending || cycles >= kCmdBatchCycles) {
+      break;
+    }
+  }
+
+  if (swap_buffers_pending) {
+    // The geometry engine stays busy until the buffers have been swapped at V-blank.
+    gxstat.test_busy = false;
+  } else if (cycles == 0) {
+    gxstat.gx_busy = false;
+    gxstat.test_busy = false;
+  } else {
+    cmd_event = scheduler.Add(cycles, [this](int cycles_late) {
+      gxstat.gx_busy = false;
+      gxstat.test_busy = false;
+      cmd_event = nullptr;
+      ProcessCommands();
+    });
+  }
+}
+
+auto GPU::GetCommandCycles(u8 command) -> int {
+  int cycles = kCmdCycles[command];
+
+  switch (command) {
+    case 0x18:
+    case 0x19:
+    case 0x1A:
+    case 0x1C: {
+      // The direction matrix is multiplied in addition to the modelview matrix.
+      if (matrix_mode == MatrixMode::Simultaneous) {
+        cycles += 30;
+      }
+      break;
+    }
+    case 0x21: {
+      // Each enabled light beyond the first one adds a cycle.
+      int lights = 0;
+      for (int i = 0; i < 4; i++) {
+        if (poly_params.enable_light[i]) lights++;
+      }
+      cycles += std::max(lights - 1, 0);
+      break;
     }
   }
+
+  return cycles;
 }
 
 void GPU::CMD_SetMatrixMode() {
@@ -210,14 +308,14 @@ void GPU::CMD_PopMatrix() {
   switch (matrix_mode) {
     case MatrixMode::Projection: {
       projection.Pop(offset);
-      UpdateClipMatrix();
+      clip_matrix_dirty = true;
       break;
     }
     case MatrixMode::Modelview:
     case MatrixMode::Simultaneous: {
       modelview.Pop(offset);
       direction.Pop(offset);
-      UpdateClipMatrix();
+      clip_matrix_dirty = true;
       break;
     }
     case MatrixMode::Texture: {
@@ -254,14 +352,14 @@ void GPU::CMD_RestoreMatrix() {
   switch (matrix_mode) {
     case MatrixMode::Projection: {
       projection.Restore(address);
-      UpdateClipMatrix();
+      clip_matrix_dirty = true;
       break;
     }
     case MatrixMode::Modelview:
     case MatrixMode::Simultaneous: {
       modelview.Restore(address);
       direction.Restore(address);
-      UpdateClipMatrix();
+      clip_matrix_dirty = true;
       break;
     }
     case MatrixMode::Texture: {
@@ -277,18 +375,18 @@ void GPU::CMD_LoadIdentity() {
   switch (matrix_mode) {
     case MatrixMode::Projection: {
       projection.current = Matrix4<Fixed20x12>::Identity();
-      UpdateClipMatrix();
+      clip_matrix_dirty = true;
       break;
     }
     case MatrixMode::Modelview: {
       modelview.current = Matrix4<Fixed20x12>::Identity();
-      UpdateClipMatrix();
+      clip_matrix_dirty = true;
       break;
     }
     case MatrixMode::Simultaneous: {
       modelview.current = Matrix4<Fixed20x12>::Identity();
       direction.current = Matrix4<Fixed20x12>::Identity();
-      UpdateClipMatrix();
+      clip_matrix_dirty = true;
       break;
     }
     case MatrixMode::Texture: {
@@ -304,18 +402,18 @@ void GPU::CMD_LoadMatrix4x4() {
   switch (matrix_mode) {
     case MatrixMode::Projection: {
       projection.current = mat;
-      UpdateClipMatrix();
+      clip_matrix_dirty = true;
       break;
     }
     case MatrixMode::Modelview: {
       modelview.current = mat;
-      UpdateClipMatrix();
+      clip_matrix_dirty = true;
       break;
     }
     case MatrixMode::Simultaneous: {
       modelview.current = mat;
       direction.current = mat;
-      UpdateClipMatrix();
+      clip_matrix_dirty = true;
       break;
     }
     case MatrixMode::Texture: {
@@ -331,18 +429,18 @@ void GPU::CMD_LoadMatrix4x3() {
   switch (matrix_mode) {
     case MatrixMode::Projection: {
       projection.current = mat;
-      UpdateClipMatrix();
+      clip_matrix_dirty = true;
       break;
     }
     case MatrixMode::Modelview: {
       modelview.current = mat;
-      UpdateClipMatrix();
+      clip_matrix_dirty = true;
       break;
     }
     case MatrixMode::Simultaneous: {
       modelview.current = mat;
       direction.current = mat;
-      UpdateClipMatrix();
+      clip_matrix_dirty = true;
       break;
     }
     case MatrixMode::Texture: {
@@ -357,23 +455,23 @@ void GPU::CMD_MatrixMultiply4x4() {
   
   switch (matrix_mode) {
     case MatrixMode::Projection: {
-      projection.current = projection.current * mat;
-      UpdateClipMatrix();
+      projection.current = Multiply(projection.current, mat);
+      clip_matrix_dirty = true;
       break;
     }
     case MatrixMode::Modelview: {
-      modelview.current = modelview.current * mat;
-      UpdateClipMatrix();
+      modelview.current = Multiply(modelview.current, mat);
+      clip_matrix_dirty = true;
       break;
     }
     case MatrixMode::Simultaneous: {
-      modelview.current = modelview.current * mat;
-      direction.current = direction.current * mat;
-      UpdateClipMatrix();
+      modelview.current = Multiply(modelview.current, mat);
+      direction.current = Multiply(direction.current, mat);
+      clip_matrix_dirty = true;
       break;
     }
     case MatrixMode::Texture: {
-      texture.current = texture.current * mat;
+      texture.current = Multiply(texture.current, mat);
       break;
     }
   }
@@ -384,23 +482,23 @@ void GPU::CMD_MatrixMultiply4x3() {
   
   switch (matrix_mode) {
     case MatrixMode::Projection: {
-      projection.current = projection.current * mat;
-      UpdateClipMatrix();
+      projection.current = Multiply(projection.current, mat);
+      clip_matrix_dirty = true;
       break;
     }
     case MatrixMode::Modelview: {
-      modelview.current = modelview.current * mat;
-      UpdateClipMatrix();
+      modelview.current = Multiply(modelview.current, mat);
+      clip_matrix_dirty = true;
       break;
     }
     case MatrixMode::Simultaneous: {
-      modelview.current = modelview.current * mat;
-      direction.current = direction.current * mat;
-      UpdateClipMatrix();
+      modelview.current = Multiply(modelview.current, mat);
+      direction.current = Multiply(direction.current, mat);
+      clip_matrix_dirty = true;
       break;
     }
     case MatrixMode::Texture: {
-      texture.current = texture.current * mat;
+      texture.current = Multiply(texture.current, mat);
       break;
     }
   }
@@ -411,23 +509,23 @@ void GPU::CMD_MatrixMultiply3x3() {
   
   switch (matrix_mode) {
     case MatrixMode::Projection: {
-      projection.current = projection.current * mat;
-      UpdateClipMatrix();
+      projection.current = Multiply(projection.current, mat);
+      clip_matrix_dirty = true;
       break;
     }
     case MatrixMode::Modelview: {
-      modelview.current = modelview.current * mat;
-      UpdateClipMatrix();
+      modelview.current = Multiply(modelview.current, mat);
+      clip_matrix_dirty = true;
       break;
     }
     case MatrixMode::Simultaneous: {
-      modelview.current = modelview.current * mat;
-      direction.current = direction.current * mat;
-      UpdateClipMatrix();
+      modelview.current = Multiply(modelview.current, mat);
+      direction.current = Multiply(direction.current, mat);
+      clip_matrix_dirty = true;
       break;
     }
     case MatrixMode::Texture: {
-      texture.current = texture.current * mat;
+      texture.current = Multiply(texture.current, mat);
       break;
     }
   }
@@ -443,18 +541,18 @@ void GPU::CMD_MatrixScale() {
   
   switch (matrix_mode) {
     case MatrixMode::Projection: {
-      projection.current = projection.current * mat;
-      UpdateClipMatrix();
+      projection.current = Multiply(projection.current, mat);
+      clip_matrix_dirty = true;
       break;
     }
     case MatrixMode::Modelview:
     case MatrixMode::Simultaneous: {
-      modelview.current = modelview.current * mat;
-      UpdateClipMatrix();
+      modelview.current = Multiply(modelview.current, mat);
+      clip_matrix_dirty = true;
       break;
     }
     case MatrixMode::Texture: {
-      texture.current = texture.current * mat;
+      texture.current = Multiply(texture.current, mat);
       break;
     }
   }
@@ -470,18 +568,18 @@ void GPU::CMD_MatrixTranslate() {
   
   switch (matrix_mode) {
     case MatrixMode::Projection: {
-      projection.current = projection.current * mat;
-      UpdateClipMatrix();
+      projection.current = Multiply(projection.current, mat);
+      clip_matrix_dirty = true;
       break;
     }
     case MatrixMode::Modelview:
     case MatrixMode::Simultaneous: {
-      modelview.current = modelview.current * mat;
-      UpdateClipMatrix();
+      modelview.current = Multiply(modelview.current, mat);
+      clip_matrix_dirty = true;
       break;
     }
     case MatrixMode::Texture: {
-      texture.current = texture.current * mat;
+      texture.current = Multiply(texture.current, mat);
       break;
     }
   }
@@ -499,18 +597,21 @@ void GPU::CMD_SetNormal() {
   auto z = Fixed20x12{s16(((arg >> 20) & 0x3FF) << 6) >> 3};
 
   if (texture_params.transform == TextureParams::Transform::Normal) {
-    auto const& matrix = texture.current;
-
     auto t_x = Fixed20x12{vertex_uv_source.X().raw() << 12};
     auto t_y = Fixed20x12{vertex_uv_source.Y().raw() << 12};
 
+    auto uv = Multiply(texture.current, Vector4<Fixed20x12>{ x, y, z, atom::NumericConstants<Fixed20x12>::Zero() });
+
     vertex_uv = Vector2<Fixed12x4>{
-      s16((x * matrix[0].X() + y * matrix[1].X() + z * matrix[2].X() + t_x).raw() >> 12),
-      s16((x * matrix[0].Y() + y * matrix[1].Y() + z * matrix[2].Y() + t_y).raw() >> 12)
+      s16((uv.X() + t_x).raw() >> 12),
+      s16((uv.Y() + t_y).raw() >> 12)
     };
   }
 
-  auto normal = (direction.current * Vector4<Fixed20x12>{ x, y, z, atom::NumericConstants<Fixed20x12>::Zero() }).XYZ();
+  auto normal = Multiply(direction.current, Vector4<Fixed20x12>{ x, y, z, atom::NumericConstants<Fixed20x12>::Zero() });
+
+  s32 dots[8];
+  kernels.dot_light_vectors(dots, light_vectors, (s32 const*)&normal);
 
   vertex_color = material.emissive;
 
@@ -522,8 +623,8 @@ void GPU::CMD_SetNormal() {
 
     auto const& light = lights[i];
 
-    auto cos_theta = -light.direction.Dot(normal);
-    auto shinyness = -light.halfway.Dot(normal);
+    auto cos_theta = Fixed20x12{-dots[i]};
+    auto shinyness = Fixed20x12{-dots[4 + i]};
 
     // TODO: support min/max/clamp for the fixed point types.
     if (cos_theta.raw() < 0) cos_theta = atom::NumericConstants<Fixed20x12>::Zero();
@@ -570,9 +671,11 @@ void GPU::CMD_SetUV() {
     auto t_x = (matrix[2].X() + matrix[3].X()) * Fixed20x12{256};
     auto t_y = (matrix[2].Y() + matrix[3].Y()) * Fixed20x12{256};
 
+    auto uv = Multiply(matrix, Vector4<Fixed20x12>{ x, y, atom::NumericConstants<Fixed20x12>::Zero(), atom::NumericConstants<Fixed20x12>::Zero() });
+
     vertex_uv = Vector2<Fixed12x4>{
-      s16((x * matrix[0].X() + y * matrix[1].X() + t_x).raw() >> 8),
-      s16((x * matrix[0].Y() + y * matrix[1].Y() + t_y).raw() >> 8),
+      s16((uv.X() + t_x).raw() >> 8),
+      s16((uv.Y() + t_y).raw() >> 8),
     };
   } else {
     vertex_uv = vertex_uv_source;
@@ -705,23 +808,23 @@ void GPU::CMD_SetMaterialColor1() {
 void GPU::CMD_SetLightVector() {
   auto arg = Dequeue().argument;
 
-  auto& light = lights[arg >> 30];
+  auto index = arg >> 30;
 
-  auto direction = Vector4<Fixed20x12>{
+  auto direction = Multiply(this->direction.current, Vector4<Fixed20x12>{
     s16(((arg >>  0) & 0x3FF) << 6) >> 3,
     s16(((arg >> 10) & 0x3FF) << 6) >> 3,
     s16(((arg >> 20) & 0x3FF) << 6) >> 3,
     atom::NumericConstants<Fixed20x12>::Zero()
-  };
+  });
+
+  light_vectors.x[index] = direction.X().raw();
+  light_vectors.y[index] = direction.Y().raw();
+  light_vectors.z[index] = direction.Z().raw();
 
-  light.direction = (this->direction.current * direction).XYZ();
-  
   // halfway = (direction + (0, 0, -1)) * 0.5
-  light.halfway = Vector3<Fixed20x12>{
-    light.direction.X().raw() >> 1,
-    light.direction.Y().raw() >> 1,
-   (light.direction.Z() - atom::NumericConstants<Fixed20x12>::One()).raw() >> 1
-  };
+  light_vectors.x[4 + index] = direction.X().raw() >> 1;
+  light_vectors.y[4 + index] = direction.Y().raw() >> 1;
+  light_vectors.z[4 + index] = (direction.Z() - atom::NumericConstants<Fixed20x12>::One()).raw() >> 1;
 }
 
 void GPU::CMD_SetLightColor() {
@@ -754,6 +857,119 @@ void GPU::CMD_SwapBuffers() {
   swap_buffers_pending = true;
 }
 
+void GPU::CMD_BoxTest() {
+  auto arg0 = Dequeue().argument;
+  auto arg1 = Dequeue().argument;
+  auto arg2 = Dequeue().argument;
+
+  s32 x = s16(arg0 & 0xFFFF);
+  s32 y = s16(arg0 >> 16);
+  s32 z = s16(arg1 & 0xFFFF);
+  s32 w = s16(arg1 >> 16);
+  s32 h = s16(arg2 & 0xFFFF);
+  s32 d = s16(arg2 >> 16);
+
+  UpdateClipMatrix();
+
+  // Bit 0, 1 and 2 of the corner index select the far side of the box on the X, Y and Z axis.
+  Vector4<Fixed20x12> corners[8];
+  int outside_all = 0x3F;
+  bool corner_inside = false;
+
+  for (int i = 0; i < 8; i++) {
+    corners[i] = Multiply(clip_matrix, Vector4<Fixed20x12>{
+      (i & 1) ? x + w : x,
+      (i & 2) ? y + h : y,
+      (i & 4) ? z + d : z,
+      0x1000
+    });
+
+    auto const& position = corners[i];
+
+    int outside = 0;
+
+    for (int axis = 0; axis < 3; axis++) {
+      if (position[axis] < -position.W()) outside |= 1 << (axis * 2);
+      if (position[axis] >  position.W()) outside |= 2 << (axis * 2);
+    }
+
+    corner_inside |= outside == 0;
+    outside_all &= outside;
+  }
+
+  /* The box is visible if any part of its faces is inside of the view volume.
+   * Only if neither all corners are outside of the same plane nor any corner is inside,
+   * the faces have to be clipped to find out.
+   */
+  if (corner_inside) {
+    gxstat.box_test_result = true;
+  } else if (outside_all != 0) {
+    gxstat.box_test_result = false;
+  } else {
+    static constexpr int kFaces[6][4] {
+      {0, 1, 3, 2}, {4, 5, 7, 6}, // -Z, +Z
+      {0, 2, 6, 4}, {1, 3, 7, 5}, // -X, +X
+      {0, 1, 5, 4}, {2, 3, 7, 6}  // -Y, +Y
+    };
+
+    gxstat.box_test_result = false;
+
+    for (auto const& face : kFaces) {
+      StaticVec<Vertex, 10> vertex_list;
+
+      for (int i : face) {
+        vertex_list.push_back({corners[i], {}, {}});
+      }
+
+      if (IsPolygonInViewVolume(vertex_list)) {
+        gxstat.box_test_result = true;
+        break;
+      }
+    }
+  }
+
+  gxstat.test_busy = true;
+}
+
+void GPU::CMD_PositionTest() {
+  auto arg0 = Dequeue().argument;
+  auto arg1 = Dequeue().argument;
+
+  auto position = Vector4<Fixed20x12>{
+    s16(arg0 & 0xFFFF),
+    s16(arg0 >> 16),
+    s16(arg1 & 0xFFFF),
+    0x1000
+  };
+
+  UpdateClipMatrix();
+
+  position_result = Multiply(clip_matrix, position);
+
+  // The tested position is used by following relative vertex commands, like one submitted with VTX_16.
+  position_old = position;
+
+  gxstat.test_busy = true;
+}
+
+void GPU::CMD_VectorTest() {
+  auto arg = Dequeue().argument;
+
+  auto vector = Multiply(direction.current, Vector4<Fixed20x12>{
+    s16(((arg >>  0) & 0x3FF) << 6) >> 3,
+    s16(((arg >> 10) & 0x3FF) << 6) >> 3,
+    s16(((arg >> 20) & 0x3FF) << 6) >> 3,
+    atom::NumericConstants<Fixed20x12>::Zero()
+  });
+
+  // The result is a 4.12 fixed-point number, the upper four bits are all copies of the sign bit.
+  for (int i = 0; i < 3; i++) {
+    vector_result[i] = s16(vector[i].raw() << 3) >> 3;
+  }
+
+  gxstat.test_busy = true;
+}
+
 void GPU::CheckGXFIFO_IRQ() {
   switch (gxstat.cmd_fifo_irq) {
     case GXSTAT::IRQMode::Never:
@@ -776,7 +992,10 @@ void GPU::CheckGXFIFO_IRQ() {
 }
 
 void GPU::UpdateClipMatrix() {
-  clip_matrix = projection.current * modelview.current;
+  if (clip_matrix_dirty) {
+    clip_matrix = Multiply(projection.current, modelview.current);
+    clip_matrix_dirty = false;
+  }
 }
 
 } // namespace lunar::nds
@@ -8,6 +8,7 @@
 #include "renderer/opengl/opengl_renderer.hpp"
 #include "renderer/software/software_renderer.hpp"
 #include "gpu.hpp"
+#include "polygon_sort.hpp"
 
 namespace lunar::nds {
 
@@ -16,7 +17,8 @@ GPU::GPU(Scheduler& scheduler, IRQ& irq9, DMA9& dma9, VRAM const& vram)
     , irq9(irq9)
     , dma9(dma9)
     , vram_texture(vram.region_gpu_texture)
-    , vram_palette(vram.region_gpu_palette) {
+    , vram_palette(vram.region_gpu_palette)
+    , kernels(GetGPUKernels()) {
   Reset();
 }
 
@@ -25,6 +27,7 @@ void GPU::Reset() {
   // TODO:
   //gxstat = {};
   gxfifo.Reset();
+  gxfifo_stall.Reset();
   gxpipe.Reset();
   packed_cmds = 0;
   packed_args_left = 0;
@@ -46,6 +49,7 @@ void GPU::Reset() {
   current_vertex_list.clear();
 
   for (auto& light : lights)  light = {};
+  light_vectors = {};
 
   material = {};
   toon_table.fill(0x7FFF);
@@ -60,11 +64,16 @@ void GPU::Reset() {
   direction.Reset();
   texture.Reset();
   clip_matrix = Matrix4<Fixed20x12>::Identity();
+  clip_matrix_dirty = false;
+  position_result = {};
+  for (auto& value : vector_result) value = 0;
 
   manual_translucent_y_sorting = false;
   manual_translucent_y_sorting_pending = false;
   use_w_buffer_pending = false;
   swap_buffers_pending = false;
+  gxstat.gx_busy = false;
+  gxstat.test_busy = false;
 
   renderer = std::make_unique<OpenGLRenderer>(
     vram_texture, vram_palette, disp3dcnt, alpha_test_ref, clear_color, clear_depth, fog_color, fog_offset, edge_color_table);
@@ -108,15 +117,7 @@ void GPU::WriteFogDensityTable(uint offset, u8 value) {
 
 void GPU::SwapBuffers() {
   if (swap_buffers_pending) {
-    polygons_sorted.clear();
-
-    for (int i = 0; i < polygons[buffer].count; i++) {
-      polygons_sorted.push_back(&polygons[buffer].data[i]);
-    }
-
-    std::stable_sort(polygons_sorted.begin(), polygons_sorted.end(), [](auto a, auto b) {
-      return a->sorting_key < b->sorting_key;
-    });
+    SortPolygons();
 
     buffer ^= 1;
     vertices[buffer].count = 0;
@@ -124,8 +125,21 @@ void GPU::SwapBuffers() {
     manual_translucent_y_sorting = manual_translucent_y_sorting_pending;
     renderer->SetWBufferEnable(use_w_buffer_pending);
     swap_buffers_pending = false;
+    gxstat.gx_busy = false;
     ProcessCommands();
   }
 }
 
+void GPU::SortPolygons() {
+  auto& poly_ram = polygons[buffer];
+
+  polygons_sorted.clear();
+
+  for (int i = 0; i < poly_ram.count; i++) {
+    polygons_sorted.push_back(&poly_ram.data[i]);
+  }
+
+  SortPolygonsByKey(polygons_sorted.data(), polygons_sort_buffer.data(), poly_ram.count);
+}
+
 } // namespace lunar::nds
@@ -23,6 +23,7 @@
 #include "nds/arm9/dma/dma.hpp"
 #include "nds/irq/irq.hpp"
 #include "nds/video_unit/vram.hpp"
+#include "kernels/kernels.hpp"
 #include "color.hpp"
 #include "matrix_stack.hpp"
 #include "renderer/renderer_base.hpp"
@@ -49,6 +50,11 @@ class GPU {
 
     void SwapBuffers();
 
+    // The ARM9 is stalled while writes to the full GXFIFO are held back until the geometry engine makes room for them.
+    auto IsStallingCPU() const -> bool {
+      return gxfifo_stall.Count() != 0;
+    }
+
     void Sync() {
       renderer->Sync();
     }
@@ -61,9 +67,31 @@ class GPU {
       }
       auto row = (offset >> 2) & 3;
       auto col =  offset >> 4;
+      UpdateClipMatrix();
       return static_cast<T>(clip_matrix[col][row].raw() >> ((offset & 3) * 8));
     }
 
+    template<typename T>
+    auto ReadPositionResult(u32 offset) -> T {
+      static_assert(atom::is_one_of_v<T, u8, u16, u32>, "T must be u8, u16 or u32");
+      if (offset >= 16) {
+        ATOM_UNREACHABLE();
+      }
+      return static_cast<T>(position_result[offset >> 2].raw() >> ((offset & 3) * 8));
+    }
+
+    template<typename T>
+    auto ReadVectorResult(u32 offset) -> T {
+      static_assert(atom::is_one_of_v<T, u8, u16, u32>, "T must be u8, u16 or u32");
+      if (offset >= 8) {
+        ATOM_UNREACHABLE();
+      }
+      u64 value = (u64)(u16)vector_result[0] |
+                 ((u64)(u16)vector_result[1] << 16) |
+                 ((u64)(u16)vector_result[2] << 32);
+      return static_cast<T>(value >> (offset * 8));
+    }
+
     void Render();
 
     auto GetOutput() -> void const* {
@@ -74,12 +102,12 @@ class GPU {
       return renderer->GetOutputImageType();
     }
 
-    void CaptureColor(u16* buffer, int vcount, int width, bool display_capture) {
-      renderer->CaptureColor(buffer, vcount, width, display_capture);
+    auto GetOutputFrame() const -> int {
+      return renderer->GetOutputFrame();
     }
 
-    void CaptureAlpha(int* buffer, int vcount) {
-      renderer->CaptureAlpha(buffer, vcount);
+    auto GetFrame3D(int frame) -> Frame3D const& {
+      return renderer->GetFrame3D(frame);
     }
 
     struct DISP3DCNT {
@@ -111,7 +139,7 @@ class GPU {
     } disp3dcnt;
 
     struct GXSTAT {
-      // TODO: implement (box)test and matrix stack bits.
+      // TODO: implement the matrix stack bits.
       GXSTAT(GPU& gpu) : gpu(gpu) {}
 
       auto ReadByte (uint offset) -> u8;
@@ -127,6 +155,8 @@ class GPU {
         Reserved = 3
       };
 
+      bool test_busy = false;
+      bool box_test_result = false;
       bool gx_busy = false;
       IRQMode cmd_fifo_irq = IRQMode::Never;
 
@@ -266,8 +296,10 @@ class GPU {
     void Enqueue(CmdArgPack pack);
     auto Dequeue() -> CmdArgPack;
     void ProcessCommands();
+    auto GetCommandCycles(u8 command) -> int;
     void CheckGXFIFO_IRQ();
     void UpdateClipMatrix();
+    void SortPolygons();
 
     auto DequeueMatrix4x4() -> Matrix4<Fixed20x12> {
       Matrix4<Fixed20x12> mat;
@@ -301,6 +333,21 @@ class GPU {
       return mat;
     }
 
+    static_assert(sizeof(Matrix4<Fixed20x12>) == 16 * sizeof(s32), "Matrix4<Fixed20x12> must be 16 packed 20.12 values");
+    static_assert(sizeof(Vector4<Fixed20x12>) == 4 * sizeof(s32), "Vector4<Fixed20x12> must be 4 packed 20.12 values");
+
+    auto Multiply(Matrix4<Fixed20x12> const& lhs, Matrix4<Fixed20x12> const& rhs) -> Matrix4<Fixed20x12> {
+      Matrix4<Fixed20x12> result;
+      kernels.multiply_mat4_mat4((s32*)&result, (s32 const*)&lhs, (s32 const*)&rhs);
+      return result;
+    }
+
+    auto Multiply(Matrix4<Fixed20x12> const& mat, Vector4<Fixed20x12> const& vec) -> Vector4<Fixed20x12> {
+      Vector4<Fixed20x12> result;
+      kernels.multiply_mat4_vec4((s32*)&result, (s32 const*)&mat, (s32 const*)&vec);
+      return result;
+    }
+
     void SubmitVertex(Vector4<Fixed20x12> const& position);
 
     bool IsFrontFacing(
@@ -315,6 +362,8 @@ class GPU {
       bool quadstrip
     ) -> StaticVec<Vertex, 10>;
 
+    bool IsPolygonInViewVolume(StaticVec<Vertex, 10> const& vertex_list);
+
     template<int axis, typename Comparator>
     bool ClipPolygonAgainstPlane(
       StaticVec<Vertex, 10> const& vertex_list_in,
@@ -362,6 +411,11 @@ class GPU {
 
     void CMD_SwapBuffers();
 
+    /// Test commands
+    void CMD_BoxTest();
+    void CMD_PositionTest();
+    void CMD_VectorTest();
+
     bool in_vertex_list;
     bool is_quad;
     bool is_strip;
@@ -379,6 +433,7 @@ class GPU {
     } polygons[2];
 
     StaticVec<Polygon*, 2048> polygons_sorted;
+    std::array<Polygon*, 2048> polygons_sort_buffer;
 
     /// ID of the buffer the geometry engine currently writes into (between 0 and 1).
     int buffer = 0;
@@ -403,11 +458,12 @@ class GPU {
     TextureParams texture_params;
 
     struct Light {
-      Vector3<Fixed20x12> direction;
-      Vector3<Fixed20x12> halfway;
       Color4 color;
     } lights[4];
 
+    /// Direction and halfway vectors of the lights
+    LightVectors light_vectors;
+
     struct Material {
       Color4 diffuse;
       Color4 ambient;
@@ -431,6 +487,7 @@ class GPU {
     IRQ& irq9;
     DMA9& dma9;
     FIFO<CmdArgPack, 256> gxfifo;
+    FIFO<CmdArgPack, 64> gxfifo_stall; //< Entries written while the GXFIFO was full and the geometry engine waited for the buffer swap
     FIFO<CmdArgPack, 4> gxpipe;
 
     /// Packed command processing
@@ -444,6 +501,11 @@ class GPU {
     MatrixStack<31> direction;
     MatrixStack< 1> texture;
     Matrix4<Fixed20x12> clip_matrix;
+    bool clip_matrix_dirty; //< The clip matrix is recomputed on demand, see UpdateClipMatrix()
+
+    /// Results of the position and vector test commands
+    Vector4<Fixed20x12> position_result;
+    s16 vector_result[3];
 
     Scheduler::Event* cmd_event = nullptr;
 
@@ -453,6 +515,8 @@ class GPU {
     bool swap_buffers_pending;
 
     std::unique_ptr<RendererBase> renderer;
+
+    GPUKernels const& kernels;
 };
 
 } // namespace lunar::nds
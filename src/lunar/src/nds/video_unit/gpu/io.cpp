@@ -59,8 +59,8 @@ void GPU::DISP3DCNT::WriteByte(uint offset, u8 value) {
 auto GPU::GXSTAT::ReadByte(uint offset) -> u8 {
   switch (offset) {
     case 0: {
-      // TODO: do not hardcode the box-test result to be true.
-      return 2;
+      return (test_busy ? 1 : 0) |
+             (box_test_result ? 2 : 0);
     }
     case 1: {
       return 0;
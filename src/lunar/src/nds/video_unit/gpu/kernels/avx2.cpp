@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+// This translation unit is compiled with AVX2 enabled.
+
+#include "common/simd.hpp"
+#include "kernels.hpp"
+
+#if defined(LUNAR_SIMD_X86)
+
+#include <immintrin.h>
+
+namespace lunar::nds {
+
+// Multiplies eight pairs of 20.12 values, see the SSE4.1 implementation.
+static auto MulFixed(__m256i a, __m256i b) -> __m256i {
+  const __m256i even = _mm256_srli_epi64(_mm256_mul_epi32(a, b), 12);
+  const __m256i odd  = _mm256_srli_epi64(_mm256_mul_epi32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32)), 12);
+
+  return _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+}
+
+// Two columns of the result are computed at once, one in each 128-bit half.
+static void MultiplyMat4Mat4(s32* result, s32 const* lhs, s32 const* rhs) {
+  const __m256i lhs_cols[4] {
+    _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i const*)&lhs[ 0])),
+    _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i const*)&lhs[ 4])),
+    _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i const*)&lhs[ 8])),
+    _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i const*)&lhs[12]))
+  };
+
+  for (int col = 0; col < 4; col += 2) {
+    const __m256i rhs_cols = _mm256_loadu_si256((__m256i const*)&rhs[col * 4]);
+
+    __m256i sum = MulFixed(lhs_cols[0], _mm256_shuffle_epi32(rhs_cols, 0x00));
+    sum = _mm256_add_epi32(sum, MulFixed(lhs_cols[1], _mm256_shuffle_epi32(rhs_cols, 0x55)));
+    sum = _mm256_add_epi32(sum, MulFixed(lhs_cols[2], _mm256_shuffle_epi32(rhs_cols, 0xAA)));
+    sum = _mm256_add_epi32(sum, MulFixed(lhs_cols[3], _mm256_shuffle_epi32(rhs_cols, 0xFF)));
+
+    _mm256_storeu_si256((__m256i*)&result[col * 4], sum);
+  }
+}
+
+// Two columns of the matrix are multiplied at once and the partial sums of both halves are added at the end.
+static void MultiplyMat4Vec4(s32* result, s32 const* mat, s32 const* vec) {
+  const __m256i v = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i const*)vec));
+
+  __m256i sum = MulFixed(
+    _mm256_loadu_si256((__m256i const*)&mat[0]),
+    _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1))
+  );
+  sum = _mm256_add_epi32(sum, MulFixed(
+    _mm256_loadu_si256((__m256i const*)&mat[8]),
+    _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(2, 2, 2, 2, 3, 3, 3, 3))
+  ));
+
+  _mm_storeu_si128((__m128i*)result, _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1)));
+}
+
+static void DotLightVectors(s32* result, LightVectors const& vectors, s32 const* normal) {
+  __m256i sum = MulFixed(_mm256_loadu_si256((__m256i const*)vectors.x), _mm256_set1_epi32(normal[0]));
+  sum = _mm256_add_epi32(sum, MulFixed(_mm256_loadu_si256((__m256i const*)vectors.y), _mm256_set1_epi32(normal[1])));
+  sum = _mm256_add_epi32(sum, MulFixed(_mm256_loadu_si256((__m256i const*)vectors.z), _mm256_set1_epi32(normal[2])));
+
+  _mm256_storeu_si256((__m256i*)result, sum);
+}
+
+GPUKernels const g_gpu_kernels_avx2 {
+  .multiply_mat4_mat4 = MultiplyMat4Mat4,
+  .multiply_mat4_vec4 = MultiplyMat4Vec4,
+  .dot_light_vectors = DotLightVectors
+};
+
+} // namespace lunar::nds
+
+#endif
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <atom/integer.hpp>
+
+namespace lunar::nds {
+
+// Direction (0 - 3) and halfway vectors (4 - 7) of the four lights, stored by component.
+struct LightVectors {
+  s32 x[8];
+  s32 y[8];
+  s32 z[8];
+};
+
+/* Geometry engine math on 20.12 fixed-point values, implemented once in plain C++ and once per SIMD instruction set.
+ * Matrices are stored column by column. Every product is truncated to 20.12 before it is added to the sum,
+ * so that all implementations return exactly the same results as the generic Matrix4 and Vector math.
+ */
+struct GPUKernels {
+  // result = lhs * rhs, result may be the same matrix as lhs or rhs.
+  void (*multiply_mat4_mat4)(s32* result, s32 const* lhs, s32 const* rhs);
+
+  // result = mat * vec, result may be the same vector as vec.
+  void (*multiply_mat4_vec4)(s32* result, s32 const* mat, s32 const* vec);
+
+  // Computes the dot product of each of the eight light vectors with the (transformed) normal.
+  void (*dot_light_vectors)(s32* result, LightVectors const& vectors, s32 const* normal);
+};
+
+extern GPUKernels const g_gpu_kernels_scalar;
+extern GPUKernels const g_gpu_kernels_sse41;
+extern GPUKernels const g_gpu_kernels_avx2;
+
+// Returns the fastest kernels that are supported by the host CPU.
+auto GetGPUKernels() -> GPUKernels const&;
+
+} // namespace lunar::nds
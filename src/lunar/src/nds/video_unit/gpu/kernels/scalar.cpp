@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "kernels.hpp"
+
+namespace lunar::nds {
+
+static auto MulFixed(s32 a, s32 b) -> s32 {
+  return s32((s64(a) * s64(b)) >> 12);
+}
+
+static void MultiplyMat4Mat4(s32* result, s32 const* lhs, s32 const* rhs) {
+  s32 temp[16];
+
+  for (int col = 0; col < 4; col++) {
+    for (int row = 0; row < 4; row++) {
+      s32 sum = 0;
+      for (int i = 0; i < 4; i++) {
+        sum += MulFixed(lhs[i * 4 + row], rhs[col * 4 + i]);
+      }
+      temp[col * 4 + row] = sum;
+    }
+  }
+
+  for (int i = 0; i < 16; i++) {
+    result[i] = temp[i];
+  }
+}
+
+static void MultiplyMat4Vec4(s32* result, s32 const* mat, s32 const* vec) {
+  s32 temp[4];
+
+  for (int row = 0; row < 4; row++) {
+    s32 sum = 0;
+    for (int i = 0; i < 4; i++) {
+      sum += MulFixed(mat[i * 4 + row], vec[i]);
+    }
+    temp[row] = sum;
+  }
+
+  for (int i = 0; i < 4; i++) {
+    result[i] = temp[i];
+  }
+}
+
+static void DotLightVectors(s32* result, LightVectors const& vectors, s32 const* normal) {
+  for (int i = 0; i < 8; i++) {
+    result[i] = MulFixed(vectors.x[i], normal[0]) +
+                MulFixed(vectors.y[i], normal[1]) +
+                MulFixed(vectors.z[i], normal[2]);
+  }
+}
+
+GPUKernels const g_gpu_kernels_scalar {
+  .multiply_mat4_mat4 = MultiplyMat4Mat4,
+  .multiply_mat4_vec4 = MultiplyMat4Vec4,
+  .dot_light_vectors = DotLightVectors
+};
+
+} // namespace lunar::nds
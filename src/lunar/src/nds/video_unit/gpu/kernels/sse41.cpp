@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+// This translation unit is compiled with SSE4.1 enabled.
+
+#include "common/simd.hpp"
+#include "kernels.hpp"
+
+#if defined(LUNAR_SIMD_X86)
+
+#include <smmintrin.h>
+
+namespace lunar::nds {
+
+/* Multiplies four pairs of 20.12 values.
+ * The low 32 bits of (a * b) >> 12 do not depend on the upper bits of the 64-bit product,
+ * so the logical shift returns the same result as an arithmetic shift would.
+ */
+static auto MulFixed(__m128i a, __m128i b) -> __m128i {
+  const __m128i even = _mm_srli_epi64(_mm_mul_epi32(a, b), 12);
+  const __m128i odd  = _mm_srli_epi64(_mm_mul_epi32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32)), 12);
+
+  return _mm_blend_epi16(even, _mm_slli_epi64(odd, 32), 0xCC);
+}
+
+static void MultiplyMat4Mat4(s32* result, s32 const* lhs, s32 const* rhs) {
+  const __m128i lhs_cols[4] {
+    _mm_loadu_si128((__m128i const*)&lhs[ 0]),
+    _mm_loadu_si128((__m128i const*)&lhs[ 4]),
+    _mm_loadu_si128((__m128i const*)&lhs[ 8]),
+    _mm_loadu_si128((__m128i const*)&lhs[12])
+  };
+
+  for (int col = 0; col < 4; col++) {
+    const __m128i rhs_col = _mm_loadu_si128((__m128i const*)&rhs[col * 4]);
+
+    __m128i sum = MulFixed(lhs_cols[0], _mm_shuffle_epi32(rhs_col, 0x00));
+    sum = _mm_add_epi32(sum, MulFixed(lhs_cols[1], _mm_shuffle_epi32(rhs_col, 0x55)));
+    sum = _mm_add_epi32(sum, MulFixed(lhs_cols[2], _mm_shuffle_epi32(rhs_col, 0xAA)));
+    sum = _mm_add_epi32(sum, MulFixed(lhs_cols[3], _mm_shuffle_epi32(rhs_col, 0xFF)));
+
+    _mm_storeu_si128((__m128i*)&result[col * 4], sum);
+  }
+}
+
+static void MultiplyMat4Vec4(s32* result, s32 const* mat, s32 const* vec) {
+  const __m128i v = _mm_loadu_si128((__m128i const*)vec);
+
+  __m128i sum = MulFixed(_mm_loadu_si128((__m128i const*)&mat[0]), _mm_shuffle_epi32(v, 0x00));
+  sum = _mm_add_epi32(sum, MulFixed(_mm_loadu_si128((__m128i const*)&mat[ 4]), _mm_shuffle_epi32(v, 0x55)));
+  sum = _mm_add_epi32(sum, MulFixed(_mm_loadu_si128((__m128i const*)&mat[ 8]), _mm_shuffle_epi32(v, 0xAA)));
+  sum = _mm_add_epi32(sum, MulFixed(_mm_loadu_si128((__m128i const*)&mat[12]), _mm_shuffle_epi32(v, 0xFF)));
+
+  _mm_storeu_si128((__m128i*)result, sum);
+}
+
+static void DotLightVectors(s32* result, LightVectors const& vectors, s32 const* normal) {
+  const __m128i normal_x = _mm_set1_epi32(normal[0]);
+  const __m128i normal_y = _mm_set1_epi32(normal[1]);
+  const __m128i normal_z = _mm_set1_epi32(normal[2]);
+
+  for (int i = 0; i < 8; i += 4) {
+    __m128i sum = MulFixed(_mm_loadu_si128((__m128i const*)&vectors.x[i]), normal_x);
+    sum = _mm_add_epi32(sum, MulFixed(_mm_loadu_si128((__m128i const*)&vectors.y[i]), normal_y));
+    sum = _mm_add_epi32(sum, MulFixed(_mm_loadu_si128((__m128i const*)&vectors.z[i]), normal_z));
+
+    _mm_storeu_si128((__m128i*)&result[i], sum);
+  }
+}
+
+GPUKernels const g_gpu_kernels_sse41 {
+  .multiply_mat4_mat4 = MultiplyMat4Mat4,
+  .multiply_mat4_vec4 = MultiplyMat4Vec4,
+  .dot_light_vectors = DotLightVectors
+};
+
+} // namespace lunar::nds
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atom/integer.hpp>
+
+namespace lunar::nds {
+
+/* Stable LSD radix sort of polygon pointers on the 32-bit sorting key, in three passes of 11-bit digits.
+ * Polygons with equal keys remain in submission order, like they would with std::stable_sort().
+ * scratch must have room for count pointers.
+ */
+template<typename Polygon>
+void SortPolygonsByKey(Polygon** polygons, Polygon** scratch, int count) {
+  static constexpr int kDigitBits = 11;
+  static constexpr int kDigitCount = 3;
+  static constexpr u32 kDigitMask = (1 << kDigitBits) - 1;
+
+  /* Clearing and scanning the histograms costs about as much as merge sorting ~1000 polygons
+   * (see test/polygon_sort_bench.cpp), smaller scenes are sorted with std::stable_sort().
+   */
+  static constexpr int kMinRadixSortCount = 1024;
+
+  if (count < kMinRadixSortCount) {
+    std::stable_sort(polygons, polygons + count, [](Polygon* a, Polygon* b) {
+      return a->sorting_key < b->sorting_key;
+    });
+    return;
+  }
+
+  u32 histogram[kDigitCount][1 << kDigitBits] {};
+
+  for (int i = 0; i < count; i++) {
+    auto key = polygons[i]->sorting_key;
+
+    for (int digit = 0; digit < kDigitCount; digit++) {
+      histogram[digit][(key >> (digit * kDigitBits)) & kDigitMask]++;
+    }
+  }
+
+  Polygon** src = polygons;
+  Polygon** dst = scratch;
+
+  for (int digit = 0; digit < kDigitCount; digit++) {
+    auto shift = digit * kDigitBits;
+    auto& offsets = histogram[digit];
+
+    // Skip the pass if all keys have the same digit, for example translucent polygons with manual Y-sorting.
+    if (offsets[(src[0]->sorting_key >> shift) & kDigitMask] == (u32)count) {
+      continue;
+    }
+
+    u32 offset = 0;
+
+    for (auto& bucket : offsets) {
+      auto size = bucket;
+      bucket = offset;
+      offset += size;
+    }
+
+    for (int i = 0; i < count; i++) {
+      auto poly = src[i];
+      dst[offsets[(poly->sorting_key >> shift) & kDigitMask]++] = poly;
+    }
+
+    std::swap(src, dst);
+  }
+
+  if (src != polygons) {
+    std::copy(src, src + count, polygons);
+  }
+}
+
+} // namespace lunar::nds
@@ -18,22 +18,20 @@ void GPU::SubmitVertex(Vector4<Fixed20x12> const& position) {
   }
 
   if (texture_params.transform == TextureParams::Transform::Position) {
-    auto const& matrix = texture.current;
-
-    auto x = position.X();
-    auto y = position.Y();
-    auto z = position.Z();
-
     auto t_x = Fixed20x12{vertex_uv_source.X().raw() << 12};
     auto t_y = Fixed20x12{vertex_uv_source.Y().raw() << 12};
 
+    auto uv = Multiply(texture.current, Vector4<Fixed20x12>{ position.X(), position.Y(), position.Z(), atom::NumericConstants<Fixed20x12>::Zero() });
+
     vertex_uv = Vector2<Fixed12x4>{
-      s16((x * matrix[0].X() + y * matrix[1].X() + z * matrix[2].X() + t_x).raw() >> 12),
-      s16((x * matrix[0].Y() + y * matrix[1].Y() + z * matrix[2].Y() + t_y).raw() >> 12)
+      s16((uv.X() + t_x).raw() >> 12),
+      s16((uv.Y() + t_y).raw() >> 12)
     };
   }
 
-  auto clip_position = clip_matrix * position;
+  UpdateClipMatrix();
+
+  auto clip_position = Multiply(clip_matrix, position);
 
   current_vertex_list.push_back({clip_position, vertex_color, vertex_uv});
 
@@ -305,6 +303,37 @@ auto GPU::ClipPolygon(
   return clipped[0];
 }
 
+bool GPU::IsPolygonInViewVolume(StaticVec<Vertex, 10> const& vertex_list) {
+  StaticVec<Vertex, 10> clipped[2];
+
+  clipped[0] = vertex_list;
+
+  struct CompareLt {
+    bool operator()(Fixed20x12 x, Fixed20x12 w) { return x < -w; }
+  };
+
+  struct CompareGt {
+    bool operator()(Fixed20x12 x, Fixed20x12 w) { return x >  w; }
+  };
+
+  // Unlike ClipPolygon() this clips against the far plane regardless of the polygon attributes.
+  ClipPolygonAgainstPlane<2, CompareGt>(clipped[0], clipped[1]);
+  clipped[0].clear();
+  ClipPolygonAgainstPlane<2, CompareLt>(clipped[1], clipped[0]);
+  clipped[1].clear();
+
+  ClipPolygonAgainstPlane<1, CompareGt>(clipped[0], clipped[1]);
+  clipped[0].clear();
+  ClipPolygonAgainstPlane<1, CompareLt>(clipped[1], clipped[0]);
+  clipped[1].clear();
+
+  ClipPolygonAgainstPlane<0, CompareGt>(clipped[0], clipped[1]);
+  clipped[0].clear();
+  ClipPolygonAgainstPlane<0, CompareLt>(clipped[1], clipped[0]);
+
+  return !clipped[0].empty();
+}
+
 template<int axis, typename Comparator>
 bool GPU::ClipPolygonAgainstPlane(
   StaticVec<Vertex, 10> const& vertex_list_in,
@@ -491,39 +491,32 @@ void OpenGLRenderer::DoCapture() {
     glReadBuffer(GL_COLOR_ATTACHMENT0);
     glReadPixels(0, 0, 512, 384, GL_BGRA, GL_UNSIGNED_BYTE, capture);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    captured_current_frame = true;
-  }
-}
 
-void OpenGLRenderer::CaptureColor(u16* buffer, int vcount, int width, bool display_capture) {
-  DoCapture();
-
-  // @todo: support different upscale factors.
-  for(int x = 0; x < width; x++) {
-    u32 argb8888 = capture[(vcount * 512 + x) * 2];
+    // @todo: support different upscale factors.
+    for (int y = 0; y < 192; y++) {
+      for (int x = 0; x < 256; x++) {
+        u32 argb8888 = capture[(y * 512 + x) * 2];
 
-    uint a = (argb8888 >> 24) & 0xFF;
-    uint r = (argb8888 >> 16) & 0xFF;
-    uint g = (argb8888 >>  8) & 0xFF;
-    uint b = (argb8888 >>  0) & 0xFF;
+        uint a = (argb8888 >> 24) & 0xFF;
+        uint r = (argb8888 >> 16) & 0xFF;
+        uint g = (argb8888 >>  8) & 0xFF;
+        uint b = (argb8888 >>  0) & 0xFF;
 
-    u16 rgb555 = r >> 3 | g >> 3 << 5 | b >> 3 << 10;
+        u16 rgb555 = r >> 3 | g >> 3 << 5 | b >> 3 << 10;
 
-    if (display_capture) {
-      buffer[x] = rgb555 | (a != 0 ? 0x8000 : 0);
-    } else {
-      buffer[x] = a == 0 ? 0x8000 : rgb555;
+        capture_frame.color[y][x] = a == 0 ? 0x8000 : rgb555;
+        capture_frame.capture[y][x] = rgb555 | (a != 0 ? 0x8000 : 0);
+        capture_frame.alpha[y][x] = a >> 4;
+      }
     }
+
+    captured_current_frame = true;
   }
 }
 
-void OpenGLRenderer::CaptureAlpha(int* buffer, int vcount) {
+auto OpenGLRenderer::GetFrame3D(int frame) -> Frame3D const& {
   DoCapture();
-
-  // @todo: support different upscale factors.
-  for (int x = 0; x < 256; x++) {
-    buffer[x] = (int)(capture[(vcount * 512 + x) * 2] >> 28);
-  }
+  return capture_frame;
 }
 
 bool OpenGLRenderer::RenderState::operator==(OpenGLRenderer::RenderState const& other) const {
@@ -57,8 +57,7 @@ class OpenGLRenderer final : public RendererBase {
     void UpdateFogDensityTable(std::array<u8, 32> const& fog_density_table) override;
     void SetWBufferEnable(bool enable) override;
 
-    void CaptureColor(u16* buffer, int vcount, int width, bool display_capture) override;
-    void CaptureAlpha(int* buffer, int vcount) override;
+    auto GetFrame3D(int frame) -> Frame3D const& override;
 
   private:
     /**
@@ -173,6 +172,7 @@ class OpenGLRenderer final : public RendererBase {
 
     bool captured_current_frame = false;
     u32 capture[512 * 384];
+    Frame3D capture_frame;
 };
 
 } // namespace lunar::nds
\ No newline at end of file
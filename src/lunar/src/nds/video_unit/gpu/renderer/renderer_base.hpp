@@ -15,6 +15,15 @@ namespace lunar::nds {
 
 // @todo: come up with a way to nicely share definitions between the GPU and renderer.
 
+/* A completed 3D frame in the formats that the 2D engine reads, so that it can read scanlines in place.
+ * Renderers convert each frame once, instead of converting a scanline every time that it is read.
+ */
+struct Frame3D {
+  u16 color[192][256];   //< 15-bit color or 0x8000 if the pixel is transparent, as composited into BG0
+  u16 capture[192][256]; //< 15-bit color, bit 15 is set if the pixel is not transparent, as read by display capture
+  u8  alpha[192][256];   //< Blend factor (0 - 15) that the 3D layer is alpha blended with
+};
+
 class RendererBase {
   public:
     virtual ~RendererBase() = default;
@@ -27,8 +36,17 @@ class RendererBase {
     virtual void UpdateFogDensityTable(std::array<u8, 32> const& fog_density_table) {}
     virtual void SetWBufferEnable(bool enable) = 0;
 
-    virtual void CaptureColor(u16* buffer, int vcount, int width, bool display_capture) = 0;
-    virtual void CaptureAlpha(int* buffer, int vcount) = 0;
+    /* Identifies the output buffer that holds the most recently completed frame, which is updated by Sync().
+     * GetFrame3D() returns the given frame, so that the next frame can be rendered while the previous one is read.
+     */
+    virtual auto GetOutputFrame() const -> int {
+      return 0;
+    }
+
+    /* Must be called from the emulation thread. The returned frame may be read from other threads
+     * until a frame is rendered to the same output buffer.
+     */
+    virtual auto GetFrame3D(int frame) -> Frame3D const& = 0;
 
     virtual void Sync() {}
 };
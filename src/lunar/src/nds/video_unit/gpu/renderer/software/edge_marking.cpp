@@ -42,6 +42,9 @@ void SoftwareRenderer::RenderEdgeMarking() {
         if (edge) {
           // TODO: decode color on write to the edge color table.
           color_buffer[c] = Color4::FromRGB555(edge_color_table[poly_id >> 3]);
+
+          // The bands have been resolved already.
+          ResolvePixel(x, y);
         }
       }
     }
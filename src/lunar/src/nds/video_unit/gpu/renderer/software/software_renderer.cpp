@@ -5,6 +5,7 @@
  * found in the LICENSE file.
  */
 
+#include "common/thread_pool.hpp"
 #include "software_renderer.hpp"
 
 namespace lunar::nds {
@@ -35,17 +36,31 @@ SoftwareRenderer::SoftwareRenderer(
     attribute_buffer[i] = {};
   }
 
-  SetupRenderWorkers();
+  for (render_frame = 0; render_frame < 2; render_frame++) {
+    ResolveOutput(0, 191);
+  }
+  render_frame = 0;
 }
 
 SoftwareRenderer::~SoftwareRenderer() {
-  JoinRenderWorkers();
+  // Band jobs reference this renderer, make sure that none of them is still running.
+  waiter.Wait(pending_bands, [](int pending_bands) {
+    return pending_bands == 0;
+  });
 }
 
 void SoftwareRenderer::Render(const void** polygons_, int polygon_count) {
+  // The previous frame may still be rendering from the VRAM copies that are updated below.
+  waiter.Wait(pending_bands, [](int pending_bands) {
+    return pending_bands == 0;
+  });
+
   this->polygons = (const GPU::Polygon**)polygons_;
   this->polygon_count = polygon_count;
 
+  render_frame = output_frame ^ 1;
+  render_pending = true;
+
   for (u32 address = 0; address < 0x80000; address += 8) {
     *(u64*)&vram_texture_copy[address] = vram_texture.Read<u64>(address);
   }
@@ -54,93 +69,42 @@ void SoftwareRenderer::Render(const void** polygons_, int polygon_count) {
     *(u64*)&vram_palette_copy[address] = vram_palette.Read<u64>(address);
   }
 
-  for (auto& render_worker : render_workers) {
-    std::lock_guard lock{render_worker.rendering_mutex};
-    render_worker.rendering = true;
-    render_worker.rendering_cv.notify_one();
-  }
-}
-
-void SoftwareRenderer::CaptureColor(u16* buffer, int vcount, int width, bool display_capture) {
-  for(int x = 0; x < width; x++) {
-    auto& color = color_buffer[vcount * 256 + x];
+  constexpr int lines_per_band = 192 / kRenderBandCount;
 
-    if(display_capture) {
-      buffer[x] = color.ToRGB555() | (color.A() != 0 ? 0x8000 : 0);
-    } else {
-      buffer[x] = color.A() == 0 ? 0x8000 : color.ToRGB555();
-    }
-  }
-}
-
-void SoftwareRenderer::CaptureAlpha(int* buffer, int vcount) {
-  for(int x = 0; x < 256; x++) {
-    buffer[x] = color_buffer[vcount * 256 + x].A().raw() >> 2;
-  }
-}
+  pending_bands = kRenderBandCount;
 
-void SoftwareRenderer::SetupRenderWorkers() {
-  int min_y = 0;
-  int lines_per_thread = 192 / kRenderThreadCount;
+  for (int band = 0; band < kRenderBandCount; band++) {
+    const int band_min_y = band * lines_per_band;
+    const int band_max_y = band_min_y + lines_per_band - 1;
 
-  JoinRenderWorkers();
+    ThreadPool::Shared().Submit([this, band_min_y, band_max_y]() {
+      RenderRearPlane(band_min_y, band_max_y);
+      RenderPolygons(band_min_y, band_max_y);
+      ResolveOutput(band_min_y, band_max_y);
 
-  for (auto& render_worker : render_workers) {
-    render_worker.min_y = min_y;
-    render_worker.max_y = min_y + lines_per_thread - 1;
-    render_worker.running = true;
-    render_worker.rendering = false;
-    min_y += lines_per_thread;
+      if (--pending_bands == 0) {
+        pending_bands.notify_one();
+      }
+    });
   }
+}
 
-  // In case 192 is not evenly divisible by the number of threads,
-  // makes sure that all scanlines are covered.
-  render_workers[kRenderThreadCount - 1].max_y = 191;
-
-  for (auto& render_worker : render_workers) {
-    render_worker.thread = std::thread{[this, &render_worker]() {
-      while (render_worker.running) {
-        if (render_worker.rendering) {
-          const int thread_min_y = render_worker.min_y;
-          const int thread_max_y = render_worker.max_y;
-
-          RenderRearPlane(thread_min_y, thread_max_y);
-          RenderPolygons(thread_min_y, thread_max_y);
-
-          std::unique_lock lock{render_worker.rendering_mutex};
-          render_worker.rendering = false;
-          render_worker.rendering_cv.wait(lock, [&](){return (bool)render_worker.rendering;});
-        }
-      }
-    }};
+void SoftwareRenderer::ResolveOutput(int thread_min_y, int thread_max_y) {
+  for (int y = thread_min_y; y <= thread_max_y; y++) {
+    for (int x = 0; x < 256; x++) {
+      ResolvePixel(x, y);
+    }
   }
 }
 
 void SoftwareRenderer::WaitForRenderWorkers() {
-  for (auto& render_worker : render_workers) {
-    // TODO: this is inefficient - solve properly
-    while (render_worker.rendering) {}
-  }
+  waiter.Wait(pending_bands, [](int pending_bands) {
+    return pending_bands == 0;
+  });
 
   if (disp3dcnt.enable_edge_marking) {
     RenderEdgeMarking();
   }
 }
 
-void SoftwareRenderer::JoinRenderWorkers() {
-  for (auto& render_worker : render_workers) {
-    if (render_worker.running) {
-      // Wake the render worker up in case it is currently sleeping:
-      render_worker.rendering_mutex.lock();
-      render_worker.rendering = true;
-      render_worker.rendering_cv.notify_one();
-      render_worker.rendering_mutex.unlock();
-
-      // Stop the thread and join it:
-      render_worker.running = false;
-      render_worker.thread.join();
-    }
-  }
-}
-
 } // namespace lunar::nds
@@ -12,10 +12,8 @@
 
 #include <atom/punning.hpp>
 #include <atomic>
-#include <condition_variable>
-#include <mutex>
-#include <thread>
 
+#include "common/wait.hpp"
 #include "nds/video_unit/gpu/renderer/renderer_base.hpp"
 #include "nds/video_unit/gpu/color.hpp"
 #include "nds/video_unit/vram_region.hpp"
@@ -48,17 +46,27 @@ class SoftwareRenderer final : public RendererBase {
       return VideoDevice::ImageType::Software;
     }
 
+    auto GetOutputFrame() const -> int override {
+      return output_frame;
+    }
+
     void Render(void const** polygons, int polygon_count) override;
 
     void SetWBufferEnable(bool enable) override {
       use_w_buffer = enable;
     }
 
-    void CaptureColor(u16* buffer, int vcount, int width, bool display_capture);
-    void CaptureAlpha(int* buffer, int vcount) override;
+    auto GetFrame3D(int frame) -> Frame3D const& override {
+      return output[frame];
+    }
 
     void Sync() override {
-      WaitForRenderWorkers();
+      // Without a new frame, output[render_frame] is still the previous output and may be read by the PPU.
+      if (render_pending) {
+        WaitForRenderWorkers();
+        output_frame = render_frame;
+        render_pending = false;
+      }
     }
 
   private:
@@ -94,10 +102,20 @@ class SoftwareRenderer final : public RendererBase {
     void RenderRearPlane(int thread_min_y, int thread_max_y);
     void RenderPolygons(int thread_min_y, int thread_max_y);
     void RenderEdgeMarking();
+    void ResolveOutput(int thread_min_y, int thread_max_y);
+
+    void ResolvePixel(int x, int y) {
+      auto const& color = color_buffer[y * 256 + x];
+      auto& frame = output[render_frame];
+      u16 rgb555 = color.ToRGB555();
+      bool opaque = color.A() != 0;
+
+      frame.color[y][x] = opaque ? rgb555 : 0x8000;
+      frame.capture[y][x] = rgb555 | (opaque ? 0x8000 : 0);
+      frame.alpha[y][x] = color.A().raw() >> 2;
+    }
 
-    void SetupRenderWorkers();
     void WaitForRenderWorkers();
-    void JoinRenderWorkers();
 
     auto SampleTexture(
       GPU::TextureParams const& params,
@@ -120,25 +138,31 @@ class SoftwareRenderer final : public RendererBase {
 
     bool use_w_buffer = false;
 
-    // Color, depth and attribute buffers
+    // Color buffer of the frame that is being rendered
     Color4 color_buffer[256 * 192];
+
+    /* Output of the last completed frame and of the frame that is being rendered.
+     * The PPU may still read the completed frame while the next one is rendered.
+     */
+    Frame3D output[2];
+    int render_frame = 0;
+    int output_frame = 0;
+    bool render_pending = false; //< Render() has been called since the last Sync()
+
+    // Depth and attribute buffers
     u32 depth_buffer[256 * 192];
     Attribute attribute_buffer[256 * 192];
 
     const GPU::Polygon** polygons = nullptr;
     int polygon_count = 0;
 
-    static constexpr int kRenderThreadCount = 4;
-
-    struct RenderWorker {
-      int min_y;
-      int max_y;
-      std::thread thread;
-      std::atomic_bool running;
-      std::atomic_bool rendering;
-      std::mutex rendering_mutex;
-      std::condition_variable rendering_cv;
-    } render_workers[kRenderThreadCount];
+    // Each frame is split into bands of scanlines which are rendered by the shared thread pool.
+    static constexpr int kRenderBandCount = 8;
+
+    static_assert(192 % kRenderBandCount == 0);
+
+    std::atomic_int pending_bands = 0;
+    AdaptiveWaiter waiter;
 };
 
 } // namespace lunar::nds
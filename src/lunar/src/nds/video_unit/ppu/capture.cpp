@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <algorithm>
+#include <string.h>
+
+#include "ppu.hpp"
+
+namespace lunar::nds {
+
+void PPU::RunDisplayCapture(u16 vcount) {
+  auto const& capture = display_capture.lines[vcount];
+  auto width = capture.width;
+  auto buffer_dst = display_capture.output[vcount];
+
+  // Both sources are read in place.
+  u16 const* source_a = capture.source_a_3d ? render_frame->frame_3d->capture[vcount] : buffer_compose[vcount];
+  u16 const* source_b = (u16 const*)&render_vram_lcdc[capture.read_address];
+
+  switch (capture.source) {
+    case DisplayCapture::Source::A: {
+      memcpy(buffer_dst, source_a, sizeof(u16) * width);
+      break;
+    }
+    case DisplayCapture::Source::B: {
+      memcpy(buffer_dst, source_b, sizeof(u16) * width);
+      break;
+    }
+    case DisplayCapture::Source::Blend: {
+      auto eva = std::min(capture.eva, 16);
+      auto evb = std::min(capture.evb, 16);
+      bool need_clamp = (eva + evb) > 16;
+
+      for (int x = 0; x < width; x++) {
+        auto color_a = source_a[x];
+        auto color_b = source_b[x];
+
+        auto r_a = (color_a >>  0) & 31;
+        auto g_a = (color_a >>  5) & 31;
+        auto b_a = (color_a >> 10) & 31;
+        auto a_a =  color_a >> 15;
+
+        auto r_b = (color_b >>  0) & 31;
+        auto g_b = (color_b >>  5) & 31;
+        auto b_b = (color_b >> 10) & 31;
+        auto a_b =  color_b >> 15;
+
+        auto factor_a = a_a * eva;
+        auto factor_b = a_b * evb;
+
+        auto r_out = (r_a * factor_a + r_b * factor_b + 8) >> 4;
+        auto g_out = (g_a * factor_a + g_b * factor_b + 8) >> 4;
+        auto b_out = (b_a * factor_a + b_b * factor_b + 8) >> 4;
+        auto a_out = (eva > 0 ? a_a : 0) | (evb > 0 ? a_b : 0);
+
+        if (need_clamp) {
+          r_out = std::min(r_out, 15);
+          g_out = std::min(g_out, 15);
+          b_out = std::min(b_out, 15);
+        }
+
+        buffer_dst[x] = r_out | (g_out << 5) | (b_out << 10) | (a_out << 15);
+      }
+      break;
+    }
+  }
+
+  // Later scanlines read the captured pixels from the render-side copy, VRAM is updated by WriteBackDisplayCapture().
+  memcpy(&render_vram_lcdc[capture.write_address], buffer_dst, sizeof(u16) * width);
+}
+
+auto PPU::TrackLCDCAccess(u16 vcount, s64 line) -> bool {
+  auto const& capture = display_capture.lines[vcount];
+  s64 line_done = render_worker.line;
+
+  int rows_read[2];
+  int read_count = 0;
+
+  if (mmio.dispcnt.display_mode == 2) {
+    rows_read[read_count++] = mmio.dispcnt.vram_block * 256 + vcount;
+  }
+
+  if (capture.enable && capture.source != DisplayCapture::Source::A) {
+    rows_read[read_count++] = capture.read_address >> 9;
+  }
+
+  // Scanlines before line_done have been rendered, so only accesses of later scanlines can conflict.
+  bool ordered = false;
+
+  for (int i = 0; i < read_count; i++) {
+    ordered |= display_capture.row_captured[rows_read[i]] >= line_done;
+  }
+
+  if (capture.enable) {
+    int row = capture.write_address >> 9;
+
+    ordered |= display_capture.row_captured[row] >= line_done ||
+               display_capture.row_read[row] >= line_done;
+    display_capture.row_captured[row] = line;
+  }
+
+  for (int i = 0; i < read_count; i++) {
+    display_capture.row_read[rows_read[i]] = line;
+  }
+
+  return ordered;
+}
+
+void PPU::WriteBackDisplayCapture(Region<64>& vram_lcdc, bool wait) {
+  while (display_capture.write_back_next < display_capture.write_back_end) {
+    int vcount = display_capture.write_back_next;
+    s64 line = frame_line + vcount;
+
+    if (render_worker.line <= line) {
+      if (!wait) {
+        break;
+      }
+
+      render_worker.waiter.Wait(render_worker.line, [=](s64 line_done) {
+        return line_done > line;
+      });
+    }
+
+    auto const& capture = display_capture.lines[vcount];
+
+    if (capture.enable) {
+      auto dst = vram_lcdc.GetUnsafePointer<u16>(capture.write_address);
+
+      if (likely(dst != nullptr)) {
+        memcpy(dst, display_capture.output[vcount], sizeof(u16) * capture.width);
+      }
+    }
+
+    display_capture.write_back_next++;
+  }
+}
+
+} // namespace lunar::nds
@@ -11,8 +11,12 @@
 namespace lunar::nds {
 
 template<bool window, bool blending, bool opengl>
-void PPU::ComposeScanlineTmpl(u16 vcount, int bg_min, int bg_max) {
-  auto& mmio = mmio_copy[vcount];
+void PPU::ComposeScanlineTmpl(u16 vcount, int bg_min, int bg_max, LineBuffers& buffers) {
+  auto& mmio = buffers.mmio;
+
+  auto const& buffer_bg = buffers.bg_line;
+  auto const& buffer_obj = buffers.obj;
+  auto const& buffer_win = buffers.win;
 
   u16 backdrop = ReadPalette(0, 0);
 
@@ -36,7 +40,7 @@ void PPU::ComposeScanlineTmpl(u16 vcount, int bg_min, int bg_max) {
   // Sort enabled backgrounds by their respective priority in ascending order.
   for (int prio = 3; prio >= 0; prio--) {
     for (int bg = bg_max; bg >= bg_min; bg--) {
-      if (dispcnt.enable[bg] && bgcnt[bg].priority == prio) {
+      if (dispcnt.enable[bg] && !buffers.bg_culled[bg] && bgcnt[bg].priority == prio) {
         bg_list[bg_count++] = bg;
       }
     }
@@ -49,8 +53,8 @@ void PPU::ComposeScanlineTmpl(u16 vcount, int bg_min, int bg_max) {
   const bool* win_layer_enable;
   
   if constexpr (window) {
-    win0_active = dispcnt.enable[ENABLE_WIN0] && window_scanline_enable[0];
-    win1_active = dispcnt.enable[ENABLE_WIN1] && window_scanline_enable[1];
+    win0_active = dispcnt.enable[ENABLE_WIN0] && mmio.window_scanline_enable[0];
+    win1_active = dispcnt.enable[ENABLE_WIN1] && mmio.window_scanline_enable[1];
     win2_active = dispcnt.enable[ENABLE_OBJWIN];
   }
 
@@ -67,7 +71,7 @@ void PPU::ComposeScanlineTmpl(u16 vcount, int bg_min, int bg_max) {
         win_layer_enable = winin.enable[0];
       } else if (win1_active && buffer_win[1][x]) {
         win_layer_enable = winin.enable[1];
-      } else if (win2_active && buffer_obj[x].window) {
+      } else if (win2_active && buffer_obj.window[x]) {
         win_layer_enable = winout.enable[1];
       } else {
         win_layer_enable = winout.enable[0];
@@ -102,13 +106,13 @@ void PPU::ComposeScanlineTmpl(u16 vcount, int bg_min, int bg_max) {
        */
       if ((!window || win_layer_enable[LAYER_OBJ]) &&
           dispcnt.enable[ENABLE_OBJ] &&
-          buffer_obj[x].color != s_color_transparent) {
-        int priority = buffer_obj[x].priority;
+          buffer_obj.color[x] != s_color_transparent) {
+        int priority = buffer_obj.priority[x];
 
         if (priority <= prio[0]) {
           layer[1] = layer[0];
           layer[0] = LAYER_OBJ;
-          is_alpha_obj = buffer_obj[x].alpha;
+          is_alpha_obj = buffer_obj.alpha[x];
 
           if constexpr(opengl) {
             prio[0] = priority;
@@ -133,7 +137,7 @@ void PPU::ComposeScanlineTmpl(u16 vcount, int bg_min, int bg_max) {
             pixel[i] = buffer_bg[_layer][x];
             break;
           case 4:
-            pixel[i] = buffer_obj[x].color;
+            pixel[i] = buffer_obj.color[x];
             break;
           case 5:
             pixel[i] = backdrop;
@@ -159,25 +163,25 @@ void PPU::ComposeScanlineTmpl(u16 vcount, int bg_min, int bg_max) {
         bool have_src = mmio.bldcnt.targets[1][layer[1]];
 
         if(is_alpha_obj && have_src) {
-          Blend(vcount, pixel[0], pixel[1], BlendControl::Effect::SFX_BLEND);
+          Blend(mmio, pixel[0], pixel[1], BlendControl::Effect::SFX_BLEND);
         } if(blend_mode == BlendControl::Effect::SFX_BLEND) {
           // TODO: what does HW do if "enable BG0 3D" is disabled in mode 6.
           if(layer[0] == 0 && bg0_is_3d && have_src) {
             auto real_bldalpha = mmio.bldalpha;
 
             // Someone should revoke my coding license for this.
-            mmio.bldalpha.a = buffer_3d_alpha[x];
+            mmio.bldalpha.a = buffers.alpha_3d[x];
             mmio.bldalpha.b = 16 - mmio.bldalpha.a;
 
-            Blend(vcount, pixel[0], pixel[1], BlendControl::Effect::SFX_BLEND);
+            Blend(mmio, pixel[0], pixel[1], BlendControl::Effect::SFX_BLEND);
 
             mmio.bldalpha = real_bldalpha;
           } else if(have_dst && have_src && sfx_enable) {
-            Blend(vcount, pixel[0], pixel[1], BlendControl::Effect::SFX_BLEND);
+            Blend(mmio, pixel[0], pixel[1], BlendControl::Effect::SFX_BLEND);
           }
         } else if(blend_mode != BlendControl::Effect::SFX_NONE) {
           if (have_dst && sfx_enable) {
-            Blend(vcount, pixel[0], pixel[1], blend_mode);
+            Blend(mmio, pixel[0], pixel[1], blend_mode);
           }
         }
       }
@@ -196,10 +200,7 @@ void PPU::ComposeScanlineTmpl(u16 vcount, int bg_min, int bg_max) {
             if (pixel_new != s_color_transparent) {
               pixel[0] = pixel_new;
               layer[0] = bg;
-
-              if constexpr(opengl) {
-                prio[0] = bgcnt[bg].priority;
-              }
+              prio[0] = bgcnt[bg].priority;
               break;
             }   
           }
@@ -209,11 +210,11 @@ void PPU::ComposeScanlineTmpl(u16 vcount, int bg_min, int bg_max) {
       // Check if a OBJ pixel takes priority over the top-most background pixel.
       if ((!window || win_layer_enable[LAYER_OBJ]) &&
           dispcnt.enable[ENABLE_OBJ] &&
-          buffer_obj[x].color != s_color_transparent &&
-          buffer_obj[x].priority <= prio[0]) {
-        pixel[0] = buffer_obj[x].color;
+          buffer_obj.color[x] != s_color_transparent &&
+          buffer_obj.priority[x] <= prio[0]) {
+        pixel[0] = buffer_obj.color[x];
         layer[0] = LAYER_OBJ;
-        prio[0] = buffer_obj[x].priority;
+        prio[0] = buffer_obj.priority[x];
       }
 
       if constexpr(opengl) {
@@ -223,15 +224,15 @@ void PPU::ComposeScanlineTmpl(u16 vcount, int bg_min, int bg_max) {
     }
 
     if constexpr(!opengl) {
-      buffer_compose[x] = pixel[0] | 0x8000;
+      buffer_compose[vcount][x] = pixel[0] | 0x8000;
     }
 
     buffer_index++;
   }
 }
 
-void PPU::ComposeScanline(u16 vcount, int bg_min, int bg_max) {
-  auto const& mmio = mmio_copy[vcount];
+void PPU::ComposeScanline(u16 vcount, int bg_min, int bg_max, LineBuffers& buffers) {
+  auto const& mmio = buffers.mmio;
   auto const& dispcnt = mmio.dispcnt;
 
   int key = 0;
@@ -242,32 +243,106 @@ void PPU::ComposeScanline(u16 vcount, int bg_min, int bg_max) {
     key |= 1;
   }
 
-  if (mmio.bldcnt.sfx != BlendControl::Effect::SFX_NONE || line_contains_alpha_obj) {
+  if (mmio.bldcnt.sfx != BlendControl::Effect::SFX_NONE || buffers.obj_contains_alpha) {
     key |= 2;
   }
 
-  if (ogl.enabled) {
+  if (render_frame->opengl) {
     key |= 4;
+  } else if (kernels.compose_scanline != nullptr) {
+    ComposeScanlineKernel(vcount, bg_min, bg_max, buffers, key & 1, key & 2);
+    return;
   }
 
   switch (key) {
-    case 0b000: ComposeScanlineTmpl<false, false, false>(vcount, bg_min, bg_max); break;
-    case 0b001: ComposeScanlineTmpl<true,  false, false>(vcount, bg_min, bg_max); break;
-    case 0b010: ComposeScanlineTmpl<false, true,  false>(vcount, bg_min, bg_max); break;
-    case 0b011: ComposeScanlineTmpl<true,  true,  false>(vcount, bg_min, bg_max); break;
-    case 0b100: ComposeScanlineTmpl<false, false, true >(vcount, bg_min, bg_max); break;
-    case 0b101: ComposeScanlineTmpl<true,  false, true >(vcount, bg_min, bg_max); break;
-    case 0b110: ComposeScanlineTmpl<false, true,  true >(vcount, bg_min, bg_max); break;
-    case 0b111: ComposeScanlineTmpl<true,  true,  true >(vcount, bg_min, bg_max); break;
+    case 0b000: ComposeScanlineTmpl<false, false, false>(vcount, bg_min, bg_max, buffers); break;
+    case 0b001: ComposeScanlineTmpl<true,  false, false>(vcount, bg_min, bg_max, buffers); break;
+    case 0b010: ComposeScanlineTmpl<false, true,  false>(vcount, bg_min, bg_max, buffers); break;
+    case 0b011: ComposeScanlineTmpl<true,  true,  false>(vcount, bg_min, bg_max, buffers); break;
+    case 0b100: ComposeScanlineTmpl<false, false, true >(vcount, bg_min, bg_max, buffers); break;
+    case 0b101: ComposeScanlineTmpl<true,  false, true >(vcount, bg_min, bg_max, buffers); break;
+    case 0b110: ComposeScanlineTmpl<false, true,  true >(vcount, bg_min, bg_max, buffers); break;
+    case 0b111: ComposeScanlineTmpl<true,  true,  true >(vcount, bg_min, bg_max, buffers); break;
   }
 }
 
-void PPU::Blend(u16  vcount,
+void PPU::ComposeScanlineKernel(u16 vcount, int bg_min, int bg_max, LineBuffers& buffers, bool window, bool blending) {
+  auto const& mmio = buffers.mmio;
+  auto const& dispcnt = mmio.dispcnt;
+
+  ComposerInput input;
+
+  for (int bg = 0; bg < 4; bg++) {
+    input.bg[bg] = buffers.bg_line[bg];
+    input.bg_priority[bg] = mmio.bgcnt[bg].priority;
+  }
+
+  input.obj_color = buffers.obj.color;
+  input.obj_priority = buffers.obj.priority;
+  input.obj_alpha = buffers.obj.alpha;
+  input.obj_window = buffers.obj.window;
+  input.win[0] = buffers.win[0];
+  input.win[1] = buffers.win[1];
+
+  bool bg0_is_3d = dispcnt.enable_bg0_3d || dispcnt.bg_mode == 6;
+
+  input.alpha_3d = (bg0_is_3d && dispcnt.enable[ENABLE_BG0]) ? buffers.alpha_3d : nullptr;
+
+  // Sort enabled backgrounds by their respective priority in ascending order.
+  input.bg_count = 0;
+
+  for (int prio = 3; prio >= 0; prio--) {
+    for (int bg = bg_max; bg >= bg_min; bg--) {
+      if (dispcnt.enable[bg] && !buffers.bg_culled[bg] && mmio.bgcnt[bg].priority == prio) {
+        input.bg_list[input.bg_count++] = bg;
+      }
+    }
+  }
+
+  input.enable_obj = dispcnt.enable[ENABLE_OBJ];
+  input.backdrop = ReadPalette(0, 0);
+
+  auto layer_mask = [](bool const* enable) -> u16 {
+    u16 mask = 0;
+
+    for (int layer = 0; layer < 6; layer++) {
+      if (enable[layer]) {
+        mask |= 1 << layer;
+      }
+    }
+    return mask;
+  };
+
+  input.window = window;
+
+  if (window) {
+    input.win_active[0] = dispcnt.enable[ENABLE_WIN0] && mmio.window_scanline_enable[0];
+    input.win_active[1] = dispcnt.enable[ENABLE_WIN1] && mmio.window_scanline_enable[1];
+    input.win_active[2] = dispcnt.enable[ENABLE_OBJWIN];
+    input.win_layers[0] = layer_mask(mmio.winin.enable[0]);
+    input.win_layers[1] = layer_mask(mmio.winin.enable[1]);
+    input.win_layers[2] = layer_mask(mmio.winout.enable[1]);
+    input.win_layers[3] = layer_mask(mmio.winout.enable[0]);
+  }
+
+  input.blending = blending;
+
+  if (blending) {
+    input.sfx = (ComposerInput::Effect)mmio.bldcnt.sfx;
+    input.targets[0] = layer_mask(mmio.bldcnt.targets[0]);
+    input.targets[1] = layer_mask(mmio.bldcnt.targets[1]);
+    input.eva = mmio.bldalpha.a;
+    input.evb = mmio.bldalpha.b;
+    input.evy = mmio.bldy.y;
+  }
+
+  kernels.compose_scanline(buffer_compose[vcount], input);
+}
+
+void PPU::Blend(MMIO const& mmio,
                 u16& target1,
                 u16  target2,
                 BlendControl::Effect sfx) {
-  auto const& mmio = mmio_copy[vcount];
-
   int r1 = (target1 >>  0) & 0x1F;
   int g1 = (target1 >>  5) & 0x1F;
   int b1 = (target1 >> 10) & 0x1F;
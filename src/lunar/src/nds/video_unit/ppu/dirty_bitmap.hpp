@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <atom/integer.hpp>
+#include <algorithm>
+#include <stddef.h>
+
+namespace lunar::nds {
+
+/* Tracks which blocks of a memory region have been written to, at cache line granularity.
+ * Writes to distant addresses therefore do not cause everything in between to be copied.
+ */
+template<size_t size, int block_shift = 6>
+class DirtyBitmap {
+  public:
+    // Marks all blocks which overlap the byte range [lo, hi) as dirty.
+    void Set(size_t lo, size_t hi) {
+      if (lo >= hi) {
+        return;
+      }
+
+      size_t block_lo = lo >> block_shift;
+      size_t block_hi = ((hi - 1) >> block_shift) + 1;
+
+      while (block_lo < block_hi) {
+        size_t word = block_lo >> 6;
+        size_t bit = block_lo & 63;
+        size_t count = std::min<size_t>(64 - bit, block_hi - block_lo);
+
+        words[word] |= (count == 64 ? ~0ULL : ((1ULL << count) - 1)) << bit;
+        block_lo += count;
+      }
+    }
+
+    void SetAll() {
+      Set(0, size);
+    }
+
+    void Clear() {
+      for (auto& word : words) {
+        word = 0;
+      }
+    }
+
+    // Calls callback(lo, hi) for every run of consecutive dirty blocks, in ascending order.
+    template<typename Callback>
+    void ForEachSpan(Callback&& callback) const {
+      size_t run_lo = 0;
+      bool in_run = false;
+
+      for (size_t word = 0; word < kWordCount; word++) {
+        u64 bits = words[word];
+
+        // Fast path for runs that cover or skip an entire word.
+        if (bits == (in_run ? ~0ULL : 0ULL)) {
+          continue;
+        }
+
+        for (size_t bit = 0; bit < 64; bit++) {
+          bool dirty = bits & (1ULL << bit);
+
+          if (dirty != in_run) {
+            size_t address = ((word << 6) + bit) << block_shift;
+
+            if (dirty) {
+              run_lo = address;
+            } else {
+              callback(run_lo, address);
+            }
+            in_run = dirty;
+          }
+        }
+      }
+
+      if (in_run) {
+        callback(run_lo, size);
+      }
+    }
+
+  private:
+    static constexpr size_t kBlockCount = (size + (1 << block_shift) - 1) >> block_shift;
+    static constexpr size_t kWordCount = (kBlockCount + 63) / 64;
+
+    u64 words[kWordCount] {};
+};
+
+} // namespace lunar::nds
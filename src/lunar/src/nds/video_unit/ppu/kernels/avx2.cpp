@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+// This translation unit is compiled with AVX2 enabled.
+
+#include "common/simd.hpp"
+#include "kernels.hpp"
+
+#if defined(LUNAR_SIMD_X86)
+
+#include <immintrin.h>
+
+namespace lunar::nds {
+
+namespace sse41 {
+
+void DecodeTileLine4BPP(u16* buffer, u32 data, u16 const* palette, bool flip);
+
+} // namespace lunar::nds::sse41
+
+static void DecodeTileLine8BPP(u16* buffer, u64 data, u16 const* palette, u16 color_mask, bool flip) {
+  __m256i indices = _mm256_cvtepu8_epi32(_mm_cvtsi64_si128((long long)data));
+
+  if (flip) {
+    indices = _mm256_permutevar8x32_epi32(indices, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+  }
+
+  /* Gather the aligned 32-bit words which contain the palette entries and then select the correct half.
+   * Gathering 32-bit words at the address of each entry would read past the end of the palette.
+   */
+  const __m256i words = _mm256_i32gather_epi32((int const*)palette, _mm256_srli_epi32(indices, 1), 4);
+  const __m256i shift = _mm256_slli_epi32(_mm256_and_si256(indices, _mm256_set1_epi32(1)), 4);
+
+  __m256i colors = _mm256_srlv_epi32(words, shift);
+  colors = _mm256_and_si256(colors, _mm256_set1_epi32(color_mask));
+
+  const __m256i transparent = _mm256_cmpeq_epi32(indices, _mm256_setzero_si256());
+  colors = _mm256_blendv_epi8(colors, _mm256_set1_epi32(0x8000), transparent);
+
+  _mm_storeu_si128((__m128i*)buffer, _mm_packus_epi32(
+    _mm256_castsi256_si128(colors),
+    _mm256_extracti128_si256(colors, 1)
+  ));
+}
+
+namespace avx2 {
+
+// Sixteen 16-bit lanes, used by the compositor.
+struct Vector {
+  using Vec = __m256i;
+
+  static constexpr int kLanes = 16;
+
+  static auto Set1(u16 value) -> Vec { return _mm256_set1_epi16((short)value); }
+  static auto Load16(u16 const* data) -> Vec { return _mm256_loadu_si256((__m256i const*)data); }
+  static auto Load8(void const* data) -> Vec { return _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i const*)data)); }
+  static void Store16(u16* data, Vec value) { _mm256_storeu_si256((__m256i*)data, value); }
+  static void Store32(u32* data, Vec lo, Vec hi) {
+    // PUNPCK*WD interleaves within each 128-bit half, restore the order of the elements afterwards.
+    __m256i elements_lo = _mm256_unpacklo_epi16(lo, hi);
+    __m256i elements_hi = _mm256_unpackhi_epi16(lo, hi);
+    _mm256_storeu_si256((__m256i*)&data[0], _mm256_permute2x128_si256(elements_lo, elements_hi, 0x20));
+    _mm256_storeu_si256((__m256i*)&data[8], _mm256_permute2x128_si256(elements_lo, elements_hi, 0x31));
+  }
+
+  static auto And(Vec a, Vec b) -> Vec { return _mm256_and_si256(a, b); }
+  static auto AndNot(Vec a, Vec b) -> Vec { return _mm256_andnot_si256(a, b); } //< ~a & b
+  static auto Or(Vec a, Vec b) -> Vec { return _mm256_or_si256(a, b); }
+  static auto CmpEq(Vec a, Vec b) -> Vec { return _mm256_cmpeq_epi16(a, b); }
+  static auto CmpGt(Vec a, Vec b) -> Vec { return _mm256_cmpgt_epi16(a, b); }
+  static auto Select(Vec mask, Vec a, Vec b) -> Vec { return _mm256_blendv_epi8(b, a, mask); } //< mask ? a : b
+  static auto Add(Vec a, Vec b) -> Vec { return _mm256_add_epi16(a, b); }
+  static auto Sub(Vec a, Vec b) -> Vec { return _mm256_sub_epi16(a, b); }
+  static auto Mul(Vec a, Vec b) -> Vec { return _mm256_mullo_epi16(a, b); }
+  static auto Min(Vec a, Vec b) -> Vec { return _mm256_min_epi16(a, b); }
+
+  template<int n> static auto Srl(Vec a) -> Vec { return _mm256_srli_epi16(a, n); }
+  template<int n> static auto Sll(Vec a) -> Vec { return _mm256_slli_epi16(a, n); }
+};
+
+#include "compose.inl"
+#include "output.inl"
+
+} // namespace lunar::nds::avx2
+
+// 4BPP tiles only need a 16-entry palette lookup, which is handled well by PSHUFB already.
+PPUKernels const g_ppu_kernels_avx2 {
+  .decode_tile_line_4bpp = sse41::DecodeTileLine4BPP,
+  .decode_tile_line_8bpp = DecodeTileLine8BPP,
+  .compose_scanline = avx2::ComposeScanline<avx2::Vector>,
+  .convert_scanline = avx2::ConvertScanline<avx2::Vector>
+};
+
+} // namespace lunar::nds
+
+#endif
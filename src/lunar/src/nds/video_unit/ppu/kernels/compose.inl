@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Vectorized scanline compositor, shared between the SSE4.1 and AVX2 kernels.
+ * It is written against a vector type V with 16-bit lanes, which is provided by the including translation unit:
+ *   V::kLanes, V::Set1, V::Load16, V::Load8 (bytes, zero-extended),
+ *   V::Store16, V::And, V::AndNot, V::Or, V::CmpEq, V::CmpGt, V::Select, V::Add, V::Sub, V::Mul, V::Min,
+ *   V::Srl<n> and V::Sll<n>.
+ * Note that this code is compiled with the instruction set of the including translation unit enabled,
+ * so it must not call any inline functions or templates which are shared with other translation units (e.g. std::min).
+ */
+
+template<typename V>
+struct ComposeVectorOps {
+  using Vec = typename V::Vec;
+
+  static auto IsSet(Vec value, Vec bits) -> Vec {
+    return V::CmpEq(V::And(value, bits), bits);
+  }
+
+  static auto IsNonZero(Vec value) -> Vec {
+    return V::AndNot(V::CmpEq(value, V::Set1(0)), V::Set1(0xFFFF));
+  }
+
+  static auto Channel(Vec color, Vec mask, int shift) -> Vec {
+    switch (shift) {
+      case 5:  return V::And(V::template Srl<5>(color), mask);
+      case 10: return V::And(V::template Srl<10>(color), mask);
+    }
+    return V::And(color, mask);
+  }
+
+  static auto Pack(Vec r, Vec g, Vec b) -> Vec {
+    return V::Or(r, V::Or(V::template Sll<5>(g), V::template Sll<10>(b)));
+  }
+
+  static auto AlphaBlend(Vec target1, Vec target2, Vec eva, Vec evb) -> Vec {
+    const Vec mask = V::Set1(0x1F);
+    Vec channels[3];
+
+    for (int i = 0; i < 3; i++) {
+      Vec c1 = Channel(target1, mask, i * 5);
+      Vec c2 = Channel(target2, mask, i * 5);
+
+      channels[i] = V::Min(V::template Srl<4>(V::Add(V::Mul(c1, eva), V::Mul(c2, evb))), mask);
+    }
+
+    return Pack(channels[0], channels[1], channels[2]);
+  }
+
+  static auto Brighten(Vec target1, Vec evy) -> Vec {
+    const Vec mask = V::Set1(0x1F);
+    Vec channels[3];
+
+    for (int i = 0; i < 3; i++) {
+      Vec c = Channel(target1, mask, i * 5);
+
+      channels[i] = V::Add(c, V::template Srl<4>(V::Mul(V::Sub(mask, c), evy)));
+    }
+
+    return Pack(channels[0], channels[1], channels[2]);
+  }
+
+  static auto Darken(Vec target1, Vec evy) -> Vec {
+    const Vec mask = V::Set1(0x1F);
+    Vec channels[3];
+
+    for (int i = 0; i < 3; i++) {
+      Vec c = Channel(target1, mask, i * 5);
+
+      channels[i] = V::Sub(c, V::template Srl<4>(V::Mul(c, evy)));
+    }
+
+    return Pack(channels[0], channels[1], channels[2]);
+  }
+};
+
+template<typename V, bool window, bool blending>
+static void ComposeScanlineImpl(u16* output, ComposerInput const& input) {
+  using Vec = typename V::Vec;
+  using Ops = ComposeVectorOps<V>;
+
+  const Vec transparent = V::Set1(0x8000);
+  const Vec layer_obj = V::Set1(ComposerInput::LAYER_OBJ);
+  const Vec layer_sfx = V::Set1(ComposerInput::LAYER_SFX);
+
+  // OBJs are simply masked out if the OBJ layer is disabled.
+  const u16 layer_mask = input.enable_obj ? 0x3F : (0x3F & ~ComposerInput::LAYER_OBJ);
+
+  const Vec win_layers[4] {
+    V::Set1(input.win_layers[0] & layer_mask),
+    V::Set1(input.win_layers[1] & layer_mask),
+    V::Set1(input.win_layers[2] & layer_mask),
+    V::Set1(input.win_layers[3] & layer_mask)
+  };
+
+  Vec bg_layer[4];
+  Vec bg_priority[4];
+
+  for (int i = 0; i < input.bg_count; i++) {
+    int bg = input.bg_list[i];
+
+    bg_layer[i] = V::Set1(1 << bg);
+    bg_priority[i] = V::Set1(input.bg_priority[bg]);
+  }
+
+  const Vec eva = V::Set1(input.eva < 16 ? input.eva : 16);
+  const Vec evb = V::Set1(input.evb < 16 ? input.evb : 16);
+  const Vec evy = V::Set1(input.evy < 16 ? input.evy : 16);
+  const Vec targets[2] { V::Set1(input.targets[0]), V::Set1(input.targets[1]) };
+
+  for (int x = 0; x < 256; x += V::kLanes) {
+    Vec layers = V::Set1(layer_mask);
+
+    if constexpr (window) {
+      // Apply the windows from the lowest to the highest priority.
+      layers = win_layers[3];
+
+      if (input.win_active[2]) {
+        layers = V::Select(Ops::IsNonZero(V::Load8(&input.obj_window[x])), win_layers[2], layers);
+      }
+
+      if (input.win_active[1]) {
+        layers = V::Select(Ops::IsNonZero(V::Load8(&input.win[1][x])), win_layers[1], layers);
+      }
+
+      if (input.win_active[0]) {
+        layers = V::Select(Ops::IsNonZero(V::Load8(&input.win[0][x])), win_layers[0], layers);
+      }
+    }
+
+    Vec pixel[2] { V::Set1(input.backdrop), V::Set1(input.backdrop) };
+    Vec layer[2] { V::Set1(ComposerInput::LAYER_BD), V::Set1(ComposerInput::LAYER_BD) };
+    Vec prio[2]  { V::Set1(4), V::Set1(4) };
+
+    // Visit the backgrounds from the lowest to the highest priority, every visible pixel pushes down the previous top-most one.
+    for (int i = 0; i < input.bg_count; i++) {
+      Vec color = V::Load16(&input.bg[input.bg_list[i]][x]);
+      Vec visible = V::AndNot(V::CmpEq(color, transparent), Ops::IsSet(layers, bg_layer[i]));
+
+      if constexpr (blending) {
+        pixel[1] = V::Select(visible, pixel[0], pixel[1]);
+        layer[1] = V::Select(visible, layer[0], layer[1]);
+        prio[1]  = V::Select(visible, prio[0],  prio[1]);
+      }
+
+      pixel[0] = V::Select(visible, color, pixel[0]);
+      layer[0] = V::Select(visible, bg_layer[i], layer[0]);
+      prio[0]  = V::Select(visible, bg_priority[i], prio[0]);
+    }
+
+    // Insert OBJ pixels above the first or second layer if their priority is the same or higher.
+    Vec obj_color = V::Load16(&input.obj_color[x]);
+    Vec obj_priority = V::Load8(&input.obj_priority[x]);
+    Vec obj_visible = V::AndNot(V::CmpEq(obj_color, transparent), Ops::IsSet(layers, layer_obj));
+    Vec obj_top = V::AndNot(V::CmpGt(obj_priority, prio[0]), obj_visible);
+
+    if constexpr (blending) {
+      Vec obj_second = V::AndNot(V::Or(obj_top, V::CmpGt(obj_priority, prio[1])), obj_visible);
+
+      pixel[1] = V::Select(obj_top, pixel[0], V::Select(obj_second, obj_color, pixel[1]));
+      layer[1] = V::Select(obj_top, layer[0], V::Select(obj_second, layer_obj, layer[1]));
+    }
+
+    pixel[0] = V::Select(obj_top, obj_color, pixel[0]);
+    layer[0] = V::Select(obj_top, layer_obj, layer[0]);
+
+    if constexpr (blending) {
+      Vec have_dst = Ops::IsNonZero(V::And(layer[0], targets[0]));
+      Vec have_src = Ops::IsNonZero(V::And(layer[1], targets[1]));
+      Vec sfx_enable = Ops::IsSet(layers, layer_sfx);
+
+      // Semi-transparent OBJs are blended regardless of the selected effect.
+      Vec is_alpha_obj = V::And(obj_top, Ops::IsNonZero(V::Load8(&input.obj_alpha[x])));
+
+      pixel[0] = V::Select(V::And(is_alpha_obj, have_src), Ops::AlphaBlend(pixel[0], pixel[1], eva, evb), pixel[0]);
+
+      switch (input.sfx) {
+        case ComposerInput::SFX_BLEND: {
+          Vec blend = V::And(have_dst, V::And(have_src, sfx_enable));
+          Vec result = V::Select(blend, Ops::AlphaBlend(pixel[0], pixel[1], eva, evb), pixel[0]);
+
+          // The 3D layer is blended using its per-pixel alpha, even if it isn't a first target.
+          if (input.alpha_3d != nullptr) {
+            Vec eva_3d = V::Min(V::Load8(&input.alpha_3d[x]), V::Set1(16));
+            Vec evb_3d = V::Sub(V::Set1(16), eva_3d);
+            Vec is_3d = V::And(V::CmpEq(layer[0], V::Set1(ComposerInput::LAYER_BG0)), have_src);
+
+            result = V::Select(is_3d, Ops::AlphaBlend(pixel[0], pixel[1], eva_3d, evb_3d), result);
+          }
+
+          pixel[0] = result;
+          break;
+        }
+        case ComposerInput::SFX_BRIGHTEN: {
+          pixel[0] = V::Select(V::And(have_dst, sfx_enable), Ops::Brighten(pixel[0], evy), pixel[0]);
+          break;
+        }
+        case ComposerInput::SFX_DARKEN: {
+          pixel[0] = V::Select(V::And(have_dst, sfx_enable), Ops::Darken(pixel[0], evy), pixel[0]);
+          break;
+        }
+        default: {
+          break;
+        }
+      }
+    }
+
+    V::Store16(&output[x], V::Or(pixel[0], transparent));
+  }
+}
+
+template<typename V>
+static void ComposeScanline(u16* output, ComposerInput const& input) {
+  if (input.window) {
+    if (input.blending) {
+      ComposeScanlineImpl<V, true, true>(output, input);
+    } else {
+      ComposeScanlineImpl<V, true, false>(output, input);
+    }
+  } else {
+    if (input.blending) {
+      ComposeScanlineImpl<V, false, true>(output, input);
+    } else {
+      ComposeScanlineImpl<V, false, false>(output, input);
+    }
+  }
+}
@@ -0,0 +1,28 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "common/simd.hpp"
+#include "kernels.hpp"
+
+namespace lunar::nds {
+
+auto GetPPUKernels() -> PPUKernels const& {
+  static PPUKernels const& kernels = []() -> PPUKernels const& {
+#if defined(LUNAR_SIMD_X86)
+    switch (GetHostSIMDLevel()) {
+      case SIMDLevel::AVX2:  return g_ppu_kernels_avx2;
+      case SIMDLevel::SSE41: return g_ppu_kernels_sse41;
+      default: break;
+    }
+#endif
+    return g_ppu_kernels_scalar;
+  }();
+
+  return kernels;
+}
+
+} // namespace lunar::nds
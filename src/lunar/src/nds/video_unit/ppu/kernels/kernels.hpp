@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <atom/integer.hpp>
+#include <lunar/device/video_device.hpp>
+
+namespace lunar::nds {
+
+// Per-scanline inputs of the compositor kernel, prepared by the PPU.
+struct ComposerInput {
+  enum Effect {
+    SFX_NONE,
+    SFX_BLEND,
+    SFX_BRIGHTEN,
+    SFX_DARKEN
+  };
+
+  // Layer bits that are used in the window and blend target masks.
+  enum Layer {
+    LAYER_BG0 = 1 << 0,
+    LAYER_OBJ = 1 << 4,
+    LAYER_BD  = 1 << 5, //< Backdrop in the blend target masks
+    LAYER_SFX = 1 << 5  //< Color special effects in the window masks
+  };
+
+  u16 const* bg[4]; //< 0x8000 is transparent
+  u16 const* obj_color; //< 0x8000 is transparent
+  u8 const* obj_priority;
+  bool const* obj_alpha;
+  bool const* obj_window;
+  bool const* win[2];
+  u8 const* alpha_3d; //< Per-pixel blend factor of the 3D BG0 layer or nullptr if BG0 is not 3D
+
+  int bg_list[4]; //< Enabled backgrounds, sorted from the lowest to the highest priority
+  int bg_count;
+  u16 bg_priority[4];
+  bool enable_obj;
+  u16 backdrop;
+
+  bool window;
+  bool win_active[3]; //< WIN0, WIN1, OBJ window
+  u16 win_layers[4]; //< Layer masks inside of WIN0, WIN1 and the OBJ window and outside of all windows
+
+  bool blending; //< False if neither color special effects nor semi-transparent OBJs need to be handled
+  Effect sfx;
+  u16 targets[2]; //< Layer masks of the first and second blend target
+  int eva;
+  int evb;
+  int evy;
+};
+
+// Master brightness adjustment that is applied by the output stage.
+enum class BrightnessMode {
+  None,
+  Up,
+  Down
+};
+
+/* Hot PPU inner loops, implemented once in plain C++ and once per SIMD instruction set.
+ * The SIMD implementations live in their own translation units, which are compiled with the matching
+ * instruction set enabled, and are only called if the host CPU supports it.
+ */
+struct PPUKernels {
+  /* Decodes a row of eight 4BPP tile pixels (one nibble per pixel, leftmost pixel in the lowest bits).
+   * Index zero is transparent, the other indices select a color from the 16-color palette.
+   */
+  void (*decode_tile_line_4bpp)(u16* buffer, u32 data, u16 const* palette, bool flip);
+
+  /* Decodes a row of eight 8BPP tile pixels (one byte per pixel, leftmost pixel in the lowest bits).
+   * Index zero is transparent, the other indices select a color from the 256-color palette,
+   * which is ANDed with color_mask (0x7FFF for PRAM, 0xFFFF for extended palettes).
+   */
+  void (*decode_tile_line_8bpp)(u16* buffer, u64 data, u16 const* palette, u16 color_mask, bool flip);
+
+  /* Composes the 256 pixels of a scanline from the layer buffers (window selection, layer priority and color special effects).
+   * The output pixels have bit 15 set. nullptr if there is no vectorized implementation,
+   * in which case the PPU uses its generic compositor.
+   */
+  void (*compose_scanline)(u16* output, ComposerInput const& input);
+
+  /* Converts a scanline of 256 RGB555 pixels (bit 15 is ignored) to an output pixel format and applies the master brightness.
+   * The master brightness is applied to 8-bit color channels. factor must be in the range 0 - 16.
+   */
+  void (*convert_scanline)(void* output, u16 const* input, VideoDevice::PixelFormat format, BrightnessMode mode, int factor);
+};
+
+extern PPUKernels const g_ppu_kernels_scalar;
+extern PPUKernels const g_ppu_kernels_sse41;
+extern PPUKernels const g_ppu_kernels_avx2;
+
+// Returns the fastest kernels that are supported by the host CPU.
+auto GetPPUKernels() -> PPUKernels const&;
+
+} // namespace lunar::nds
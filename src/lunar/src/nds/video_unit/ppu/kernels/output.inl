@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Vectorized output stage (color conversion and master brightness), shared between the SSE4.1 and AVX2 kernels.
+ * Uses the same vector type V as compose.inl, plus V::Store32(u32* data, Vec lo, Vec hi),
+ * which interleaves the lanes of lo (bits 0 - 15) and hi (bits 16 - 31) into 32-bit elements.
+ */
+
+template<typename V, VideoDevice::PixelFormat format, BrightnessMode mode>
+static void ConvertScanlineImpl(void* output, u16 const* input, int factor) {
+  using Vec = typename V::Vec;
+
+  const Vec mask = V::Set1(0xF8);
+  const Vec white = V::Set1(0xFF);
+  const Vec evy = V::Set1((u16)factor);
+
+  for (int x = 0; x < 256; x += V::kLanes) {
+    Vec color = V::Load16(&input[x]);
+    Vec r = V::And(V::template Sll<3>(color), mask);
+    Vec g = V::And(V::template Srl<2>(color), mask);
+    Vec b = V::And(V::template Srl<7>(color), mask);
+
+    Vec* channels[3] {&r, &g, &b};
+
+    for (auto channel : channels) {
+      if constexpr (mode == BrightnessMode::Up) {
+        *channel = V::Add(*channel, V::template Srl<4>(V::Mul(V::Sub(white, *channel), evy)));
+      }
+
+      if constexpr (mode == BrightnessMode::Down) {
+        *channel = V::Sub(*channel, V::template Srl<4>(V::Mul(*channel, evy)));
+      }
+    }
+
+    if constexpr (format == VideoDevice::PixelFormat::BGRA8888) {
+      V::Store32(&((u32*)output)[x], V::Or(b, V::template Sll<8>(g)), V::Or(r, V::Set1(0xFF00)));
+    }
+
+    if constexpr (format == VideoDevice::PixelFormat::RGBA8888) {
+      V::Store32(&((u32*)output)[x], V::Or(r, V::template Sll<8>(g)), V::Or(b, V::Set1(0xFF00)));
+    }
+
+    if constexpr (format == VideoDevice::PixelFormat::RGB565) {
+      Vec rgb = V::Or(V::template Sll<8>(V::And(r, mask)), V::Or(V::template Sll<3>(V::And(g, V::Set1(0xFC))), V::template Srl<3>(b)));
+
+      V::Store16(&((u16*)output)[x], rgb);
+    }
+
+    if constexpr (format == VideoDevice::PixelFormat::BGR555) {
+      Vec rgb = V::Or(V::template Srl<3>(r), V::Or(V::template Sll<2>(V::And(g, mask)), V::template Sll<7>(V::And(b, mask))));
+
+      V::Store16(&((u16*)output)[x], V::Or(rgb, V::Set1(0x8000)));
+    }
+  }
+}
+
+template<typename V, VideoDevice::PixelFormat format>
+static void ConvertScanlineImpl(void* output, u16 const* input, BrightnessMode mode, int factor) {
+  switch (mode) {
+    case BrightnessMode::None: ConvertScanlineImpl<V, format, BrightnessMode::None>(output, input, factor); break;
+    case BrightnessMode::Up:   ConvertScanlineImpl<V, format, BrightnessMode::Up  >(output, input, factor); break;
+    case BrightnessMode::Down: ConvertScanlineImpl<V, format, BrightnessMode::Down>(output, input, factor); break;
+  }
+}
+
+template<typename V>
+static void ConvertScanline(void* output, u16 const* input, VideoDevice::PixelFormat format, BrightnessMode mode, int factor) {
+  switch (format) {
+    case VideoDevice::PixelFormat::BGRA8888: ConvertScanlineImpl<V, VideoDevice::PixelFormat::BGRA8888>(output, input, mode, factor); break;
+    case VideoDevice::PixelFormat::RGBA8888: ConvertScanlineImpl<V, VideoDevice::PixelFormat::RGBA8888>(output, input, mode, factor); break;
+    case VideoDevice::PixelFormat::RGB565:   ConvertScanlineImpl<V, VideoDevice::PixelFormat::RGB565  >(output, input, mode, factor); break;
+    case VideoDevice::PixelFormat::BGR555:   ConvertScanlineImpl<V, VideoDevice::PixelFormat::BGR555  >(output, input, mode, factor); break;
+  }
+}
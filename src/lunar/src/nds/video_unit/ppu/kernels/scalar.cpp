@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "kernels.hpp"
+
+namespace lunar::nds {
+
+static constexpr u16 kColorTransparent = 0x8000;
+
+static void DecodeTileLine4BPP(u16* buffer, u32 data, u16 const* palette, bool flip) {
+  uint xor_x = flip ? 7 : 0;
+
+  for (uint x = 0; x < 8; x++) {
+    auto index = data & 15;
+    buffer[x ^ xor_x] = index == 0 ? kColorTransparent : (palette[index] & 0x7FFF);
+    data >>= 4;
+  }
+}
+
+static void DecodeTileLine8BPP(u16* buffer, u64 data, u16 const* palette, u16 color_mask, bool flip) {
+  uint xor_x = flip ? 7 : 0;
+
+  for (uint x = 0; x < 8; x++) {
+    auto index = data & 0xFF;
+    buffer[x ^ xor_x] = index == 0 ? kColorTransparent : (palette[index] & color_mask);
+    data >>= 8;
+  }
+}
+
+template<VideoDevice::PixelFormat format, BrightnessMode mode>
+static void ConvertScanlineTmpl(void* output, u16 const* input, int factor) {
+  for (int x = 0; x < 256; x++) {
+    u16 color = input[x];
+    u32 r = (color << 3) & 0xF8;
+    u32 g = (color >> 2) & 0xF8;
+    u32 b = (color >> 7) & 0xF8;
+
+    u32* channels[3] {&r, &g, &b};
+
+    for (auto channel : channels) {
+      if constexpr (mode == BrightnessMode::Up) {
+        *channel += ((255 - *channel) * factor) >> 4;
+      }
+
+      if constexpr (mode == BrightnessMode::Down) {
+        *channel -= (*channel * factor) >> 4;
+      }
+    }
+
+    switch (format) {
+      case VideoDevice::PixelFormat::BGRA8888:
+        ((u32*)output)[x] = r << 16 | g << 8 | b | 0xFF000000;
+        break;
+      case VideoDevice::PixelFormat::RGBA8888:
+        ((u32*)output)[x] = b << 16 | g << 8 | r | 0xFF000000;
+        break;
+      case VideoDevice::PixelFormat::RGB565:
+        ((u16*)output)[x] = (r >> 3) << 11 | (g >> 2) << 5 | (b >> 3);
+        break;
+      case VideoDevice::PixelFormat::BGR555:
+        ((u16*)output)[x] = (r >> 3) | (g >> 3) << 5 | (b >> 3) << 10 | 0x8000;
+        break;
+    }
+  }
+}
+
+template<VideoDevice::PixelFormat format>
+static void ConvertScanlineTmpl(void* output, u16 const* input, BrightnessMode mode, int factor) {
+  switch (mode) {
+    case BrightnessMode::None: ConvertScanlineTmpl<format, BrightnessMode::None>(output, input, factor); break;
+    case BrightnessMode::Up:   ConvertScanlineTmpl<format, BrightnessMode::Up  >(output, input, factor); break;
+    case BrightnessMode::Down: ConvertScanlineTmpl<format, BrightnessMode::Down>(output, input, factor); break;
+  }
+}
+
+static void ConvertScanline(void* output, u16 const* input, VideoDevice::PixelFormat format, BrightnessMode mode, int factor) {
+  switch (format) {
+    case VideoDevice::PixelFormat::BGRA8888: ConvertScanlineTmpl<VideoDevice::PixelFormat::BGRA8888>(output, input, mode, factor); break;
+    case VideoDevice::PixelFormat::RGBA8888: ConvertScanlineTmpl<VideoDevice::PixelFormat::RGBA8888>(output, input, mode, factor); break;
+    case VideoDevice::PixelFormat::RGB565:   ConvertScanlineTmpl<VideoDevice::PixelFormat::RGB565  >(output, input, mode, factor); break;
+    case VideoDevice::PixelFormat::BGR555:   ConvertScanlineTmpl<VideoDevice::PixelFormat::BGR555  >(output, input, mode, factor); break;
+  }
+}
+
+PPUKernels const g_ppu_kernels_scalar {
+  .decode_tile_line_4bpp = DecodeTileLine4BPP,
+  .decode_tile_line_8bpp = DecodeTileLine8BPP,
+  .compose_scanline = nullptr,
+  .convert_scanline = ConvertScanline
+};
+
+} // namespace lunar::nds
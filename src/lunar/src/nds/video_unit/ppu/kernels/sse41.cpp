@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+// This translation unit is compiled with SSE4.1 enabled.
+
+#include "common/simd.hpp"
+#include "kernels.hpp"
+
+#if defined(LUNAR_SIMD_X86)
+
+#include <smmintrin.h>
+
+namespace lunar::nds {
+
+namespace sse41 {
+
+void DecodeTileLine4BPP(u16* buffer, u32 data, u16 const* palette, bool flip) {
+  // Split the palette into its low and high bytes, so that both halves can be looked up with PSHUFB.
+  const __m128i deinterleave = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+  const __m128i palette_0_7  = _mm_shuffle_epi8(_mm_loadu_si128((__m128i const*)&palette[0]), deinterleave);
+  const __m128i palette_8_15 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i const*)&palette[8]), deinterleave);
+  const __m128i palette_lo = _mm_unpacklo_epi64(palette_0_7, palette_8_15);
+  const __m128i palette_hi = _mm_unpackhi_epi64(palette_0_7, palette_8_15);
+
+  // Unpack the nibbles into one byte per pixel.
+  const __m128i nibble_mask = _mm_set1_epi8(0x0F);
+  const __m128i packed = _mm_cvtsi32_si128((int)data);
+  __m128i indices = _mm_unpacklo_epi8(
+    _mm_and_si128(packed, nibble_mask),
+    _mm_and_si128(_mm_srli_epi16(packed, 4), nibble_mask)
+  );
+
+  if (flip) {
+    indices = _mm_shuffle_epi8(indices, _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 8, 9, 10, 11, 12, 13, 14, 15));
+  }
+
+  __m128i colors = _mm_unpacklo_epi8(_mm_shuffle_epi8(palette_lo, indices), _mm_shuffle_epi8(palette_hi, indices));
+  colors = _mm_and_si128(colors, _mm_set1_epi16(0x7FFF));
+
+  const __m128i transparent = _mm_cmpeq_epi16(_mm_cvtepu8_epi16(indices), _mm_setzero_si128());
+  colors = _mm_blendv_epi8(colors, _mm_set1_epi16((short)0x8000), transparent);
+
+  _mm_storeu_si128((__m128i*)buffer, colors);
+}
+
+void DecodeTileLine8BPP(u16* buffer, u64 data, u16 const* palette, u16 color_mask, bool flip) {
+  __m128i indices = _mm_cvtepu8_epi16(_mm_cvtsi64_si128((long long)data));
+
+  if (flip) {
+    indices = _mm_shuffle_epi8(indices, _mm_setr_epi8(14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1));
+  }
+
+  // SSE has no gather instruction, the palette lookup has to be done element by element.
+  __m128i colors = _mm_setr_epi16(
+    (short)palette[_mm_extract_epi16(indices, 0)],
+    (short)palette[_mm_extract_epi16(indices, 1)],
+    (short)palette[_mm_extract_epi16(indices, 2)],
+    (short)palette[_mm_extract_epi16(indices, 3)],
+    (short)palette[_mm_extract_epi16(indices, 4)],
+    (short)palette[_mm_extract_epi16(indices, 5)],
+    (short)palette[_mm_extract_epi16(indices, 6)],
+    (short)palette[_mm_extract_epi16(indices, 7)]
+  );
+  colors = _mm_and_si128(colors, _mm_set1_epi16((short)color_mask));
+
+  const __m128i transparent = _mm_cmpeq_epi16(indices, _mm_setzero_si128());
+  colors = _mm_blendv_epi8(colors, _mm_set1_epi16((short)0x8000), transparent);
+
+  _mm_storeu_si128((__m128i*)buffer, colors);
+}
+
+// Eight 16-bit lanes, used by the compositor.
+struct Vector {
+  using Vec = __m128i;
+
+  static constexpr int kLanes = 8;
+
+  static auto Set1(u16 value) -> Vec { return _mm_set1_epi16((short)value); }
+  static auto Load16(u16 const* data) -> Vec { return _mm_loadu_si128((__m128i const*)data); }
+  static auto Load8(void const* data) -> Vec { return _mm_cvtepu8_epi16(_mm_loadl_epi64((__m128i const*)data)); }
+  static void Store16(u16* data, Vec value) { _mm_storeu_si128((__m128i*)data, value); }
+  static void Store32(u32* data, Vec lo, Vec hi) {
+    _mm_storeu_si128((__m128i*)&data[0], _mm_unpacklo_epi16(lo, hi));
+    _mm_storeu_si128((__m128i*)&data[4], _mm_unpackhi_epi16(lo, hi));
+  }
+
+  static auto And(Vec a, Vec b) -> Vec { return _mm_and_si128(a, b); }
+  static auto AndNot(Vec a, Vec b) -> Vec { return _mm_andnot_si128(a, b); } //< ~a & b
+  static auto Or(Vec a, Vec b) -> Vec { return _mm_or_si128(a, b); }
+  static auto CmpEq(Vec a, Vec b) -> Vec { return _mm_cmpeq_epi16(a, b); }
+  static auto CmpGt(Vec a, Vec b) -> Vec { return _mm_cmpgt_epi16(a, b); }
+  static auto Select(Vec mask, Vec a, Vec b) -> Vec { return _mm_blendv_epi8(b, a, mask); } //< mask ? a : b
+  static auto Add(Vec a, Vec b) -> Vec { return _mm_add_epi16(a, b); }
+  static auto Sub(Vec a, Vec b) -> Vec { return _mm_sub_epi16(a, b); }
+  static auto Mul(Vec a, Vec b) -> Vec { return _mm_mullo_epi16(a, b); }
+  static auto Min(Vec a, Vec b) -> Vec { return _mm_min_epi16(a, b); }
+
+  template<int n> static auto Srl(Vec a) -> Vec { return _mm_srli_epi16(a, n); }
+  template<int n> static auto Sll(Vec a) -> Vec { return _mm_slli_epi16(a, n); }
+};
+
+#include "compose.inl"
+#include "output.inl"
+
+} // namespace lunar::nds::sse41
+
+PPUKernels const g_ppu_kernels_sse41 {
+  .decode_tile_line_4bpp = sse41::DecodeTileLine4BPP,
+  .decode_tile_line_8bpp = sse41::DecodeTileLine8BPP,
+  .compose_scanline = sse41::ComposeScanline<sse41::Vector>,
+  .convert_scanline = sse41::ConvertScanline<sse41::Vector>
+};
+
+} // namespace lunar::nds
+
+#endif
@@ -7,8 +7,10 @@
 
 #include <atom/panic.hpp>
 #include <algorithm>
+#include <bit>
 #include <string.h>
 
+#include "common/thread_pool.hpp"
 #include "ppu.hpp"
 
 namespace lunar::nds {
@@ -20,6 +22,7 @@ PPU::PPU(
   u8   const* oam,
   GPU* gpu
 )   : id(id)
+    , kernels(GetPPUKernels())
     , vram_bg(vram.region_ppu_bg[id])
     , vram_obj(vram.region_ppu_obj[id])
     , extpal_bg(vram.region_ppu_bg_extpal[id])
@@ -80,33 +83,85 @@ void PPU::Reset() {
 
   mmio.master_bright.Reset();
 
+  mmio.powered = true;
+
+  // Writes before the first scanline are visible to it.
   current_vcount = 0;
+  current_line = -1;
+  frame_line = 0;
+
+  for (int i = 0; i < kFrameCount; i++) {
+    frames[i] = {output_format, &output[i][0], nullptr, false, memo.enable_requested, false};
+  }
 
-  vram_bg_dirty = {0, sizeof(render_vram_bg)};
-  vram_obj_dirty = {0, sizeof(render_vram_obj)};
-  extpal_bg_dirty = {0, sizeof(render_extpal_bg)};
-  extpal_obj_dirty = {0, sizeof(render_extpal_obj)};
-  vram_lcdc_dirty = {0, sizeof(render_vram_lcdc)};
-  pram_dirty = {0,sizeof(render_pram)};
-  oam_dirty = {0, sizeof(render_oam)};
+  vram_bg_dirty.SetAll();
+  vram_obj_dirty.SetAll();
+  extpal_bg_dirty.SetAll();
+  extpal_obj_dirty.SetAll();
+  vram_lcdc_dirty.SetAll();
+  pram_dirty.SetAll();
+  oam_dirty.SetAll();
 
   SetupRenderWorker();
 }
 
-void PPU::OnDrawScanlineBegin(u16 vcount, bool capture_bg_and_3d) {
-  current_vcount = vcount;
+void PPU::MMIO::WriteByte(uint offset, u8 value) {
+  switch (offset) {
+    case 0x00 ... 0x03: dispcnt.WriteByte(offset, value); break;
+    case 0x08 ... 0x0F: bgcnt[(offset - 0x08) >> 1].WriteByte(offset & 1, value); break;
+    case 0x10 ... 0x1F: {
+      if (offset & 2) {
+        bgvofs[(offset - 0x10) >> 2].WriteByte(offset & 1, value);
+      } else {
+        bghofs[(offset - 0x10) >> 2].WriteByte(offset & 1, value);
+      }
+      break;
+    }
+    case 0x20 ... 0x3F: {
+      int id = (offset - 0x20) >> 4;
+
+      switch (offset & 0xF) {
+        case 0x0 ... 0x1: bgpa[id].WriteByte(offset & 1, value); break;
+        case 0x2 ... 0x3: bgpb[id].WriteByte(offset & 1, value); break;
+        case 0x4 ... 0x5: bgpc[id].WriteByte(offset & 1, value); break;
+        case 0x6 ... 0x7: bgpd[id].WriteByte(offset & 1, value); break;
+        case 0x8 ... 0xB: bgx[id].WriteByte(offset & 3, value); break;
+        case 0xC ... 0xF: bgy[id].WriteByte(offset & 3, value); break;
+      }
+      break;
+    }
+    case 0x40 ... 0x41: winh[0].WriteByte(offset & 1, value); break;
+    case 0x42 ... 0x43: winh[1].WriteByte(offset & 1, value); break;
+    case 0x44 ... 0x45: winv[0].WriteByte(offset & 1, value); break;
+    case 0x46 ... 0x47: winv[1].WriteByte(offset & 1, value); break;
+    case 0x48 ... 0x49: winin.WriteByte(offset & 1, value); break;
+    case 0x4A ... 0x4B: winout.WriteByte(offset & 1, value); break;
+    case 0x4C ... 0x4D: mosaic.WriteByte(offset & 1, value); break;
+    case 0x50 ... 0x51: bldcnt.WriteByte(offset & 1, value); break;
+    case 0x52 ... 0x53: bldalpha.WriteByte(offset & 1, value); break;
+    case 0x54: bldy.WriteByte(0, value); break;
+    case 0x6C ... 0x6D: master_bright.WriteByte(offset & 1, value); break;
+  }
+}
+
+void PPU::OnDrawScanlineBegin(u16 vcount, bool capture_bg_and_3d, DisplayCapture const& capture) {
+  SetCurrentScanline(vcount);
 
   if (vcount == 0) {
     ogl.enabled = gpu && gpu->GetOutputImageType() == VideoDevice::ImageType::OpenGL &&
-                  mmio.dispcnt.display_mode == 1 &&
+                  mmio.powered && mmio.dispcnt.display_mode == 1 &&
                  !capture_bg_and_3d;
     ogl.done = false;
   }
 
-  SubmitScanline(vcount, capture_bg_and_3d);
+  SubmitScanline(vcount, capture_bg_and_3d, capture);
 }
 
 void PPU::OnDrawScanlineEnd() {
+  PushRegisterEvent(current_line, EVENT_SCANLINE_END, 0);
+}
+
+void PPU::EndScanline(MMIO& mmio) {
   auto& dispcnt = mmio.dispcnt;
   auto& bgx = mmio.bgx;
   auto& bgy = mmio.bgy;
@@ -143,270 +198,634 @@ void PPU::OnDrawScanlineEnd() {
 }
 
 void PPU::OnBlankScanlineBegin(u16 vcount) {
-  auto& bgx = mmio.bgx;
-  auto& bgy = mmio.bgy;
-  auto& mosaic = mmio.mosaic;
-
-  current_vcount = vcount;
+  SetCurrentScanline(vcount);
 
   // TODO: when exactly are these registers reloaded?
   if (vcount == 192) {
-    // Reset vertical mosaic counters
-    mosaic.bg._counter_y = 0;
-    mosaic.obj._counter_y = 0;
+    PushRegisterEvent(current_line - 1, EVENT_VBLANK_BEGIN, 0);
+  }
+
+  MergeOpenGLFrame(false);
 
-    // Reload internal affine registers
-    bgx[0]._current = bgx[0].initial;
-    bgy[0]._current = bgy[0].initial;
-    bgx[1]._current = bgx[1].initial;
-    bgy[1]._current = bgy[1].initial;
+  SubmitScanline(vcount, false, {});
+}
+
+void PPU::MergeOpenGLFrame(bool wait) {
+  if (!ogl.enabled || ogl.done || frames[GetFrameSlot(frame_line)].skip) {
+    return;
   }
 
-  if (ogl.enabled && !ogl.done && render_worker.vcount >= 192) {
-    Merge2DWithOpenGL3D();
-    ogl.done = true;
+  if (wait) {
+    WaitForFrame(frame_line);
+  } else if (!IsFrameRendered(frame_line)) {
+    return;
   }
 
-  SubmitScanline(vcount, false);
+  Merge2DWithOpenGL3D();
+  ogl.done = true;
 }
 
-void PPU::RenderScanline(u16 vcount, bool capture_bg_and_3d) {
-  auto display_mode = mmio_copy[vcount].dispcnt.display_mode;
+void PPU::BeginVBlank(MMIO& mmio) {
+  auto& bgx = mmio.bgx;
+  auto& bgy = mmio.bgy;
+  auto& mosaic = mmio.mosaic;
+
+  // Reset vertical mosaic counters
+  mosaic.bg._counter_y = 0;
+  mosaic.obj._counter_y = 0;
+
+  // Reload internal affine registers
+  bgx[0]._current = bgx[0].initial;
+  bgy[0]._current = bgy[0].initial;
+  bgx[1]._current = bgx[1].initial;
+  bgy[1]._current = bgy[1].initial;
+}
 
-  if (capture_bg_and_3d || display_mode == 1) {
-    RenderBackgroundsAndComposite(vcount);
+void PPU::RenderScanline(u16 vcount, bool capture_bg_and_3d, LineBuffers& buffers) {
+  // A powered-off engine displays a white screen, its layers are only composed for display capture.
+  auto display_mode = buffers.mmio.powered ? buffers.mmio.dispcnt.display_mode : 0;
+
+  if ((capture_bg_and_3d || display_mode == 1) && !TryReuseComposedLine(vcount, buffers)) {
+    RenderBackgroundsAndComposite(vcount, buffers);
   }
 
   switch (display_mode) {
     case 0: RenderDisplayOff(vcount); break;
-    case 1: RenderNormal(vcount);     break;
-    case 2: RenderVideoMemoryDisplay(vcount); break;
-    case 3: RenderMainMemoryDisplay(vcount);  break;
+    case 1: RenderNormal(vcount, buffers); break;
+    case 2: RenderVideoMemoryDisplay(vcount, buffers); break;
+    case 3: RenderMainMemoryDisplay(vcount, buffers);  break;
   }
 }
 
 void PPU::RenderDisplayOff(u16 vcount) {
-  u32* line = &output[frame][vcount * 256];
+  u16 white[256];
 
-  for (uint x = 0; x < 256; x++) {
-    line[x] = ConvertColor(0x7FFF);
-  }
+  std::fill_n(white, 256, 0x7FFF);
+  kernels.convert_scanline(GetOutputLine(vcount), white, render_frame->format, BrightnessMode::None, 0);
 }
 
-void PPU::RenderNormal(u16 vcount) {
-  u32* line = &output[frame][vcount * 256];
+void PPU::RenderNormal(u16 vcount, LineBuffers const& buffers) {
+  RenderOutputLine(vcount, buffers, buffer_compose[vcount]);
+}
 
-  for (uint x = 0; x < 256; x++) {
-    line[x] = ConvertColor(buffer_compose[x]);
-  }
+void PPU::RenderVideoMemoryDisplay(u16 vcount, LineBuffers const& buffers) {
+  auto vram_block = buffers.mmio.dispcnt.vram_block;
 
-  RenderMasterBrightness(vcount);
+  RenderOutputLine(vcount, buffers, (u16 const*)&render_vram_lcdc[vram_block * 0x20000 + vcount * 256 * sizeof(u16)]);
 }
 
-void PPU::RenderVideoMemoryDisplay(u16 vcount) {
-  u32* line = &output[frame][vcount * 256];
-  auto vram_block = mmio_copy[vcount].dispcnt.vram_block;
-  u16 const* source = (u16 const*)&render_vram_lcdc[vram_block * 0x20000 + vcount * 256 * sizeof(u16)];
+void PPU::RenderMainMemoryDisplay(u16 vcount, LineBuffers const& buffers) {
+  ATOM_PANIC("PPU: unimplemented main memory display mode.");
+}
 
-  if (source != nullptr) {
-    for (uint x = 0; x < 256; x++) {
-      line[x] = ConvertColor(*source++);
-    }
-  } else {
-    for (uint x = 0; x < 256; x++) {
-      line[x] = ConvertColor(0);
-    }
+void PPU::RenderOutputLine(u16 vcount, LineBuffers const& buffers, u16 const* source) {
+  auto const& master_bright = buffers.mmio.master_bright;
+  auto mode = BrightnessMode::None;
+
+  if (master_bright.mode != MasterBrightness::Mode::Disable && master_bright.factor != 0) {
+    mode = master_bright.mode == MasterBrightness::Mode::Up ? BrightnessMode::Up : BrightnessMode::Down;
   }
 
-  RenderMasterBrightness(vcount);
+  // Color conversion and master brightness are done in a single pass.
+  kernels.convert_scanline(GetOutputLine(vcount), source, render_frame->format, mode, std::min(master_bright.factor, 16));
 }
 
-void PPU::RenderMasterBrightness(int vcount) {
-  auto const& master_bright = mmio_copy[vcount].master_bright;
+bool PPU::TryReuseComposedLine(u16 vcount, LineBuffers const& buffers) {
+  auto const& mmio = buffers.mmio;
+  auto& line = memo.lines[vcount];
 
-  if (master_bright.mode != MasterBrightness::Mode::Disable && master_bright.factor != 0) {
-    int  factor = std::min(master_bright.factor, 16);
-    u32* buffer = &output[frame][vcount * 256];
+  // The 3D layer and the OpenGL compositor read inputs which are not tracked.
+  bool uses_3d = mmio.dispcnt.enable[ENABLE_BG0] && (mmio.dispcnt.enable_bg0_3d || mmio.dispcnt.bg_mode == 6);
 
-    if (master_bright.mode == MasterBrightness::Mode::Up) {
-      for(int x = 0; x < 256; x++) {
-        u32 rgba = *buffer;
-        u32 rgba_inv = ~rgba;
+  if (!memo.enabled || render_frame->opengl || uses_3d) {
+    line.valid = false;
+    return false;
+  }
 
-        rgba += ((((rgba_inv & 0xFF00FF) * factor) & 0xFF00FF0) |
-                 (((rgba_inv & 0x00FF00) * factor) & 0x00FF000)) >> 4;
-        *buffer++ = rgba;
-      }
-    } else {
-      for(int x = 0; x < 256; x++) {
-        u32 rgba = *buffer;
+  MMIO key;
 
-        rgba -= ((((rgba & 0xFF00FF) * factor) & 0xFF00FF0) |
-                 (((rgba & 0x00FF00) * factor) & 0x00FF000)) >> 4;
-        *buffer++ = rgba;
-      }
-    }
-  }
-}
+  // Copy the padding as well, so that the copies can be compared bytewise.
+  memcpy(&key, &mmio, sizeof(MMIO));
 
-void PPU::RenderMainMemoryDisplay(u16 vcount) {
-  ATOM_PANIC("PPU: unimplemented main memory display mode.");
+  // Master brightness is applied to the composed line afterwards, capture and power don't affect it.
+  memset(&key.master_bright, 0, sizeof(key.master_bright));
+  key.capture_bg_and_3d = false;
+  key.powered = false;
+
+  u32 generation_bg = generation.bg + generation.pram_bg;
+  u32 generation_obj = mmio.dispcnt.enable[ENABLE_OBJ] ? generation.obj + generation.pram_obj : 0;
+
+  if (line.valid &&
+      line.generation_bg == generation_bg &&
+      line.generation_obj == generation_obj &&
+      memcmp(&line.mmio, &key, sizeof(MMIO)) == 0) {
+    return true;
+  }
 
-  //RenderMasterBrightness(vcount);
+  memcpy(&line.mmio, &key, sizeof(MMIO));
+  line.generation_bg = generation_bg;
+  line.generation_obj = generation_obj;
+  line.valid = true;
+  return false;
 }
 
-void PPU::RenderBackgroundsAndComposite(u16 vcount) {
-  auto const& mmio = mmio_copy[vcount];
+void PPU::RenderBackgroundsAndComposite(u16 vcount, LineBuffers& buffers) {
+  auto const& mmio = buffers.mmio;
 
   if(mmio.dispcnt.forced_blank) {
     for(uint x = 0; x < 256; x++) {
-      buffer_compose[x] = 0xFFFF;
+      buffer_compose[vcount][x] = 0xFFFF;
     }
     return;
   }
 
+  if (mmio.dispcnt.enable[ENABLE_WIN0]) {
+    RenderWindow(0, vcount, buffers);
+  }
+
+  if (mmio.dispcnt.enable[ENABLE_WIN1]) {
+    RenderWindow(1, vcount, buffers);
+  }
+
+  // The OBJ window might be enabled even if OBJs are disabled, so always clear the OBJ buffer.
+  buffers.obj_contains_alpha = false;
+
+  std::fill_n(buffers.obj.color, 256, s_color_transparent);
+  std::fill_n(buffers.obj.priority, 256, 4);
+  std::fill_n(buffers.obj.alpha, 256, false);
+  std::fill_n(buffers.obj.window, 256, false);
+
   // TODO: on a real Nintendo DS all sprites are rendered one scanline ahead.
   if(mmio.dispcnt.enable[ENABLE_OBJ]) {
-    RenderLayerOAM(vcount);
+    RenderLayerOAM(vcount, buffers);
   }
 
-  if(mmio.dispcnt.enable[ENABLE_BG0]) {
-    // TODO: what does HW do if "enable BG0 3D" is disabled in mode 6.
-    if(mmio.dispcnt.enable_bg0_3d || mmio.dispcnt.bg_mode == 6) {
-      gpu->CaptureColor(buffer_bg[0], vcount, 256, false);
-      gpu->CaptureAlpha(buffer_3d_alpha, vcount);
-    } else {
-      RenderLayerText(0, vcount);
-    }
+  for (int bg = 0; bg < 4; bg++) {
+    buffers.bg_line[bg] = buffers.bg[bg];
   }
+  buffers.alpha_3d = nullptr;
+
+  auto const& dispcnt = mmio.dispcnt;
+
+  int bg_list[4];
+  int bg_count = 0;
 
-  if(mmio.dispcnt.enable[ENABLE_BG1] && mmio.dispcnt.bg_mode != 6) {
-    RenderLayerText(1, vcount);
+  // Render the backgrounds from the highest to the lowest priority, so that backgrounds hidden by opaque layers can be culled.
+  for (int prio = 0; prio <= 3; prio++) {
+    for (int bg = 0; bg <= 3; bg++) {
+      if (dispcnt.enable[bg] && mmio.bgcnt[bg].priority == prio) {
+        bg_list[bg_count++] = bg;
+      }
+    }
   }
 
-  if(mmio.dispcnt.enable[ENABLE_BG2]) {
-    switch(mmio.dispcnt.bg_mode) {
-      case 0:
-      case 1:
-      case 3: RenderLayerText(2, vcount); break;
-      case 2:
-      case 4: RenderLayerAffine(0, vcount); break;
-      case 5: RenderLayerExtended(0, vcount); break;
-      case 6: RenderLayerLarge(vcount); break;
+  bool window = dispcnt.enable[ENABLE_WIN0] || dispcnt.enable[ENABLE_WIN1] || dispcnt.enable[ENABLE_OBJWIN];
+
+  // A background only hides the layers below it if it is visible in every window that might cover the scanline.
+  auto visible_in_all_windows = [&](int bg) {
+    if (!window) {
+      return true;
+    }
+    if (dispcnt.enable[ENABLE_WIN0] && mmio.window_scanline_enable[0] && !mmio.winin.enable[0][bg]) {
+      return false;
+    }
+    if (dispcnt.enable[ENABLE_WIN1] && mmio.window_scanline_enable[1] && !mmio.winin.enable[1][bg]) {
+      return false;
+    }
+    if (dispcnt.enable[ENABLE_OBJWIN] && !mmio.winout.enable[1][bg]) {
+      return false;
+    }
+    return mmio.winout.enable[0][bg];
+  };
+
+  /* Alpha blending reads the two top-most layers, so two opaque backgrounds are needed to hide the backgrounds below.
+   * With OpenGL the 3D layer is merged later, so the 2D layers below it are always rendered.
+   */
+  bool two_layers = mmio.bldcnt.sfx == BlendControl::Effect::SFX_BLEND || buffers.obj_contains_alpha;
+  int opaque_needed = two_layers ? 2 : 1;
+  int opaque_count = 0;
+
+  for (int i = 0; i < bg_count; i++) {
+    int bg = bg_list[i];
+
+    buffers.bg_culled[bg] = opaque_count == opaque_needed;
+
+    if (!buffers.bg_culled[bg]) {
+      RenderLayer(bg, vcount, buffers);
+
+      if (!render_frame->opengl && visible_in_all_windows(bg) && IsOpaque(buffers.bg_line[bg])) {
+        opaque_count++;
+      }
     }
   }
 
-  if(mmio.dispcnt.enable[ENABLE_BG3]) {
-    switch (mmio.dispcnt.bg_mode) {
-      case 0: RenderLayerText(3, vcount); break;
-      case 1:
-      case 2: RenderLayerAffine(1, vcount); break;
-      case 3:
-      case 4:
-      case 5: RenderLayerExtended(1, vcount); break;
+  ComposeScanline(vcount, 0, 3, buffers);
+}
+
+void PPU::RenderLayer(uint id, u16 vcount, LineBuffers& buffers) {
+  auto const& mmio = buffers.mmio;
+
+  // Layers which do not exist in the current BG mode are transparent.
+  switch (id) {
+    case 0: {
+      // TODO: what does HW do if "enable BG0 3D" is disabled in mode 6.
+      if(mmio.dispcnt.enable_bg0_3d || mmio.dispcnt.bg_mode == 6) {
+        auto frame_3d = render_frame->frame_3d;
+
+        if (frame_3d != nullptr) {
+          buffers.bg_line[0] = frame_3d->color[vcount];
+          buffers.alpha_3d = frame_3d->alpha[vcount];
+        } else {
+          std::fill_n(buffers.bg[0], 256, s_color_transparent);
+        }
+      } else {
+        RenderLayerText(0, vcount, buffers);
+      }
+      break;
+    }
+    case 1: {
+      if(mmio.dispcnt.bg_mode != 6) {
+        RenderLayerText(1, vcount, buffers);
+      } else {
+        std::fill_n(buffers.bg[1], 256, s_color_transparent);
+      }
+      break;
+    }
+    case 2: {
+      switch(mmio.dispcnt.bg_mode) {
+        case 0:
+        case 1:
+        case 3: RenderLayerText(2, vcount, buffers); break;
+        case 2:
+        case 4: RenderLayerAffine(0, vcount, buffers); break;
+        case 5: RenderLayerExtended(0, vcount, buffers); break;
+        case 6: RenderLayerLarge(vcount, buffers); break;
+        default: std::fill_n(buffers.bg[2], 256, s_color_transparent); break;
+      }
+      break;
+    }
+    case 3: {
+      switch (mmio.dispcnt.bg_mode) {
+        case 0: RenderLayerText(3, vcount, buffers); break;
+        case 1:
+        case 2: RenderLayerAffine(1, vcount, buffers); break;
+        case 3:
+        case 4:
+        case 5: RenderLayerExtended(1, vcount, buffers); break;
+        default: std::fill_n(buffers.bg[3], 256, s_color_transparent); break;
+      }
+      break;
     }
   }
+}
+
+bool PPU::IsOpaque(u16 const* buffer) {
+  bool opaque = true;
 
-  ComposeScanline(vcount, 0, 3);
+  // No early exit, so that the loop can be vectorized.
+  for (int x = 0; x < 256; x++) {
+    opaque &= buffer[x] != s_color_transparent;
+  }
+  return opaque;
 }
 
 void PPU::SetupRenderWorker() {
   StopRenderWorker();
 
-  render_worker.vcount = 0;
-  render_worker.vcount_max = -1;
-  render_worker.running = true;
-  render_worker.ready = false;
+  write_journal.Reset();
+  register_journal.Reset();
+  render_mmio = mmio;
 
-  render_worker.thread = std::thread([this]() {
-    while (render_worker.running.load()) {
-      while (render_worker.vcount <= render_worker.vcount_max) {
-        // TODO: this might be racy with SubmitScanline() resetting render_thread_vcount.
-        int vcount = render_worker.vcount;
+  render_worker.line = 0;
+  render_worker.line_max = -1;
+  render_worker.line_next = 0;
+  render_frame = &frames[0];
 
-        if (mmio.dispcnt.enable[ENABLE_WIN0]) {
-          RenderWindow(0, vcount);
-        }
+  for (auto& capture : display_capture.lines) {
+    capture.enable = false;
+  }
+  display_capture.write_back_next = 0;
+  display_capture.write_back_end = 0;
+  std::fill_n(display_capture.row_read, 1024, -1);
+  std::fill_n(display_capture.row_captured, 1024, -1);
+}
 
-        if (mmio.dispcnt.enable[ENABLE_WIN1]) {
-          RenderWindow(1, vcount);
-        }
+void PPU::StopRenderWorker() {
+  WaitForRenderWorker();
 
-        if (vcount < 192) {
-          RenderScanline(vcount, mmio_copy[vcount].capture_bg_and_3d);
-        }
+  // Render jobs might still be about to return.
+  render_worker.waiter.Wait(render_worker.active_jobs, [](int active_jobs) {
+    return active_jobs == 0;
+  });
 
-        render_worker.vcount++;
+  // The last job notifies while it holds the mutex, so it is done with the PPU once the mutex has been released.
+  std::lock_guard lock{render_worker.mutex};
+}
+
+void PPU::RunRenderJob() {
+  LineBuffers buffers;
+
+  std::unique_lock lock{render_worker.mutex};
+
+  // There are at most kMaxRenderJobs jobs, so there always is a free tile cache.
+  int tile_cache_id = std::countr_zero(render_worker.free_tile_caches);
+  render_worker.free_tile_caches &= ~(1 << tile_cache_id);
+  buffers.tile_cache = &tile_caches[tile_cache_id];
+
+  while (true) {
+    s64 line = ClaimScanline(buffers.mmio);
+
+    if (line < 0) {
+      break;
+    }
+
+    lock.unlock();
+
+    u16 vcount = line % 263;
+
+    if (vcount < 192 && !render_frame->skip) {
+      RenderScanline(vcount, buffers.mmio.capture_bg_and_3d, buffers);
+
+      if (display_capture.lines[vcount].enable) {
+        RunDisplayCapture(vcount);
       }
+    }
+
+    lock.lock();
+
+    CompleteScanline(line);
+  }
+
+  render_worker.free_tile_caches |= 1 << tile_cache_id;
+
+  if (--render_worker.active_jobs == 0) {
+    render_worker.active_jobs.notify_one();
+  }
+}
+
+auto PPU::ClaimScanline(MMIO& line_mmio) -> s64 {
+  s64 line = render_worker.line_next;
+
+  if (line > render_worker.line_max) {
+    return -1;
+  }
+
+  /* Memory writes that happened before this scanline was submitted must be visible to it,
+   * but they must not become visible to earlier scanlines that are still being rendered.
+   * In that case the job that completes the last of those scanlines will claim this one.
+   * The same applies to the first scanline of a frame, which updates state that is shared by all scanlines,
+   * and to scanlines whose LCDC accesses conflict with a display capture of an earlier scanline.
+   */
+  bool begins_frame = line % 263 == 0;
+  bool ordered = line % 263 < 192 && display_capture.ordered[line % 263];
+
+  if (begins_frame || ordered || write_journal.HasPending(line - 1)) {
+    if (render_worker.line != line) {
+      return -1;
+    }
+    ApplyWriteJournal(line - 1);
 
-      // Wait for the emulation thread to submit more work:
-      std::unique_lock lock{render_worker.mutex};
-      render_worker.cv.wait(lock, [this]() {return render_worker.ready;});
-      render_worker.ready = false;
+    if (begins_frame) {
+      BeginRenderFrame(line);
     }
+  }
+
+  // Register writes are replayed in scanline order, since scanlines are claimed in order.
+  register_journal.Apply(line - 1, [this](u8 offset, u8 value) {
+    ApplyRegisterEvent(offset, value);
   });
+
+  if (line % 263 < 192) {
+    // Copy the padding as well, so that memoization can compare the registers bytewise.
+    memcpy(&line_mmio, &render_mmio, sizeof(MMIO));
+  }
+
+  render_worker.line_next++;
+  return line;
 }
 
-void PPU::StopRenderWorker() {
-  if (!render_worker.running) {
-    return;
+void PPU::CompleteScanline(s64 line) {
+  s64 line_done = render_worker.line;
+
+  render_worker.done[line % 263] = true;
+
+  if (line == line_done) {
+    while (line_done <= render_worker.line_max && render_worker.done[line_done % 263]) {
+      render_worker.done[line_done++ % 263] = false;
+    }
+
+    render_worker.line = line_done;
+    render_worker.line.notify_one();
   }
+}
 
-  // Wake the render worker thread up if it is working for new data:
-  render_worker.mutex.lock();
-  render_worker.ready = true;
-  render_worker.cv.notify_one();
-  render_worker.mutex.unlock();
+void PPU::SetCurrentScanline(u16 vcount) {
+  // The vertical counter wrapped around, so this is the first scanline of a new frame.
+  if (vcount < current_vcount) {
+    frame_line += 263;
+  }
 
-  // Tell the render worker thread to quit and join it:
-  render_worker.running = false;
-  render_worker.thread.join();
+  current_vcount = vcount;
+  current_line = frame_line + vcount;
 }
 
-void PPU::SubmitScanline(u16 vcount, bool capture_bg_and_3d) {
-  mmio.capture_bg_and_3d = capture_bg_and_3d;
+void PPU::SubmitScanline(u16 vcount, bool capture_bg_and_3d, DisplayCapture const& capture) {
+  s64 line = current_line;
+
+  // Each scanline of a frame has a single slot in render_worker.done, so the render worker may fall at most one frame behind.
+  render_worker.waiter.Wait(render_worker.line, [=](s64 line_done) {
+    return line_done > line - 263;
+  });
+
+  if (vcount == 0) {
+    BeginFrame(capture_bg_and_3d);
+  }
+
+  bool ordered = false;
 
   if (vcount < 192) {
-    mmio_copy[vcount] = mmio;
+    display_capture.lines[vcount] = capture;
+    if (capture.enable) {
+      display_capture.write_back_end = vcount + 1;
+    }
+    ordered = TrackLCDCAccess(vcount, line);
+  }
+
+  // Events that precede the scanline are stamped with the previous scanline, so that they are replayed before it is rendered.
+  if (capture_bg_and_3d != mmio.capture_bg_and_3d) {
+    mmio.capture_bg_and_3d = capture_bg_and_3d;
+    PushRegisterEvent(line - 1, EVENT_CAPTURE, capture_bg_and_3d);
+  }
+
+  PushRegisterEvent(line - 1, EVENT_SCANLINE_BEGIN, (u8)vcount);
+
+  /* The job is submitted after render_worker.mutex has been released.
+   * Submit() blocks while the thread pool is reconfigured, which waits for the running render jobs to complete.
+   */
+  auto max_jobs = std::min(kMaxRenderJobs, ThreadPool::Shared().GetThreadCount());
+
+  {
+    std::lock_guard lock{render_worker.mutex};
+
+    if (vcount < 192) {
+      display_capture.ordered[vcount] = ordered;
+    }
+    render_worker.line_max = line;
+
+    if (vcount >= 192 || frames[GetFrameSlot(frame_line)].skip) {
+      // Nothing to render here. If no render job is active, all previous scanlines are done and the
+      // scanline can be completed right away. Otherwise one of the active jobs will complete it.
+      if (render_worker.active_jobs == 0) {
+        render_worker.line_next = line + 1;
+        render_worker.line = line + 1;
+      }
+      return;
+    }
+
+    if (render_worker.active_jobs >= max_jobs) {
+      return;
+    }
+    render_worker.active_jobs++;
+  }
+
+  ThreadPool::Shared().Submit([this]() {
+    RunRenderJob();
+  });
+}
+
+void PPU::BeginFrame(bool capture_bg_and_3d) {
+  auto slot = GetFrameSlot(frame_line);
+  Frame3D const* frame_3d = nullptr;
+
+  /* OpenGL composites the 3D frame on the GPU, so it is only read back for display capture.
+   * The read back must happen on the main thread.
+   */
+  if (gpu != nullptr && (gpu->GetOutputImageType() != VideoDevice::ImageType::OpenGL || capture_bg_and_3d)) {
+    frame_3d = &gpu->GetFrame3D(gpu->GetOutputFrame());
+  }
+
+  // Captures of the previous frame have been written back when it entered VBlank.
+  display_capture.write_back_next = 0;
+  display_capture.write_back_end = 0;
+
+  // The slot was last used three frames ago, that frame has been rendered already.
+  frames[slot] = {
+    output_format,
+    output_buffer != nullptr ? output_buffer : &output[slot][0],
+    frame_3d,
+    ogl.enabled,
+    memo.enable_requested,
+    skip_requested
+  };
+
+  if (render_worker.line > render_worker.line_max) {
+    // The render worker is idle, so the writes from the blanking period can be copied directly.
+    FlushWriteJournal();
+
+    UpdateRenderCopy(vram_bg, render_vram_bg, vram_bg_dirty);
+    UpdateRenderCopy(vram_obj, render_vram_obj, vram_obj_dirty);
+    UpdateRenderCopy(extpal_bg, render_extpal_bg, extpal_bg_dirty);
+    UpdateRenderCopy(extpal_obj, render_extpal_obj, extpal_obj_dirty);
+    UpdateRenderCopy(vram_lcdc, render_vram_lcdc, vram_lcdc_dirty);
+    UpdateRenderCopy(pram, render_pram, pram_dirty);
+    UpdateRenderCopy(oam, render_oam, oam_dirty);
+    UpdateSpriteTable();
   } else {
-    mmio_copy[vcount].dispcnt = mmio.dispcnt;
-    mmio_copy[vcount].winh[0] = mmio.winh[0];
-    mmio_copy[vcount].winh[1] = mmio.winh[1];
-    mmio_copy[vcount].winv[0] = mmio.winv[0];
-    mmio_copy[vcount].winv[1] = mmio.winv[1];
+    // The previous frame is still being rendered, pass the writes to the render worker so that they are applied once it is done.
+    JournalRenderCopy(vram_bg, render_vram_bg, vram_bg_dirty, frame_line - 1);
+    JournalRenderCopy(vram_obj, render_vram_obj, vram_obj_dirty, frame_line - 1);
+    JournalRenderCopy(extpal_bg, render_extpal_bg, extpal_bg_dirty, frame_line - 1);
+    JournalRenderCopy(extpal_obj, render_extpal_obj, extpal_obj_dirty, frame_line - 1);
+    JournalRenderCopy(vram_lcdc, render_vram_lcdc, vram_lcdc_dirty, frame_line - 1);
+    JournalRenderCopy(pram, render_pram, pram_dirty, frame_line - 1);
+    JournalRenderCopy(oam, render_oam, oam_dirty, frame_line - 1);
   }
+}
 
-  if (vcount == 0) {
-    // @hack: make sure that glReadPixels() is called on the main thread,
-    // by issuing a dummy call to CaptureColor()
-    if(capture_bg_and_3d && gpu->GetOutputImageType() == VideoDevice::ImageType::OpenGL) {
-      gpu->CaptureColor(nullptr, 0, 0, false);
+void PPU::BeginRenderFrame(s64 line) {
+  render_frame = &frames[GetFrameSlot(line)];
+
+  if (memo.enabled != render_frame->memoize) {
+    memo.enabled = render_frame->memoize;
+
+    for (auto& line : memo.lines) {
+      line.valid = false;
+    }
+  }
+}
+
+void PPU::PushRegisterEvent(s64 line, u8 offset, u8 value) {
+  if (unlikely(!register_journal.Push(line, offset, value))) {
+    /* The journal is full, wait for the render worker to catch up and replay the remaining events right away.
+     * This is safe because all submitted scanlines have been claimed, so the events belong to the next scanline.
+     */
+    WaitForRenderWorker();
+    FlushRegisterJournal();
+    register_journal.Push(line, offset, value);
+  }
+}
+
+void PPU::ApplyRegisterEvent(u8 offset, u8 value) {
+  switch (offset) {
+    case EVENT_SCANLINE_BEGIN: UpdateWindowScanlineEnable(render_mmio, value); break;
+    case EVENT_SCANLINE_END:   EndScanline(render_mmio); break;
+    case EVENT_VBLANK_BEGIN:   BeginVBlank(render_mmio); break;
+    case EVENT_CAPTURE:        render_mmio.capture_bg_and_3d = value; break;
+    case EVENT_POWER:          render_mmio.powered = value; break;
+    default: render_mmio.WriteByte(offset, value); break;
+  }
+}
+
+void PPU::InvalidateDecodedTiles(u8 const* dst, size_t size) {
+  constexpr int kPageShift = Generations::kPageShift;
+
+  // Increments the counters of all pages of a render-side copy that overlap with the written range.
+  auto invalidate = [&](u8 const* copy, size_t copy_size, u32* counters, int shift) {
+    if (dst < copy || dst >= copy + copy_size) {
+      return false;
     }
 
-    CopyVRAM(vram_bg, render_vram_bg, vram_bg_dirty);
-    CopyVRAM(vram_obj, render_vram_obj, vram_obj_dirty);
-    CopyVRAM(extpal_bg, render_extpal_bg, extpal_bg_dirty);
-    CopyVRAM(extpal_obj, render_extpal_obj, extpal_obj_dirty);
-    CopyVRAM(vram_lcdc, render_vram_lcdc, vram_lcdc_dirty);
-    CopyVRAM(pram, render_pram, pram_dirty);
-    CopyVRAM(oam, render_oam, oam_dirty);
+    size_t offset = dst - copy;
 
-    vram_bg_dirty = {};
-    vram_obj_dirty = {};
-    extpal_bg_dirty = {};
-    extpal_obj_dirty = {};
-    vram_lcdc_dirty = {};
-    pram_dirty = {};
-    oam_dirty = {};
+    for (size_t i = offset >> shift; i <= (offset + size - 1) >> shift; i++) {
+      counters[i]++;
+    }
+    return true;
+  };
 
-    render_worker.vcount = 0;
+  if (size == 0) {
+    return;
   }
 
-  render_worker.vcount_max = vcount;
+  if (invalidate(render_vram_bg, sizeof(render_vram_bg), generation.vram_bg, kPageShift) ||
+      invalidate(render_extpal_bg, sizeof(render_extpal_bg), generation.extpal_bg, kPageShift)) {
+    generation.bg++;
+    return;
+  }
 
-  std::lock_guard lock{render_worker.mutex};
-  render_worker.ready = true;
-  render_worker.cv.notify_one();
+  if (invalidate(render_vram_obj, sizeof(render_vram_obj), generation.vram_obj, kPageShift) ||
+      invalidate(render_extpal_obj, sizeof(render_extpal_obj), generation.extpal_obj, kPageShift)) {
+    generation.obj++;
+    return;
+  }
+
+  if (dst >= render_oam && dst < render_oam + sizeof(render_oam)) {
+    sprite_table.dirty = true;
+    generation.obj++;
+    return;
+  }
+
+  if (invalidate(render_pram, sizeof(render_pram), generation.pram, 5)) {
+    size_t offset = dst - render_pram;
+
+    if (offset < 0x200) {
+      generation.pram_bg++;
+    }
+
+    if (offset + size > 0x200) {
+      generation.pram_obj++;
+    }
+  }
 }
 
 void PPU::RegisterMapUnmapCallbacks() {
@@ -9,22 +9,27 @@
 
 #include <atom/punning.hpp>
 #include <atomic>
-#include <condition_variable>
-#include <functional>
 #include <lunar/device/video_device.hpp>
 #include <atom/integer.hpp>
 #include <mutex>
-#include <thread>
+#include <string.h>
 
+#include "common/likely.hpp"
 #include "common/ogl/buffer_object.hpp"
 #include "common/ogl/frame_buffer_object.hpp"
 #include "common/ogl/program_object.hpp"
 #include "common/ogl/texture_2d.hpp"
 #include "common/ogl/vertex_array_object.hpp"
+#include "common/wait.hpp"
 #include "nds/video_unit/gpu/color.hpp"
 #include "nds/video_unit/gpu/gpu.hpp"
 #include "nds/video_unit/vram.hpp"
+#include "kernels/kernels.hpp"
+#include "dirty_bitmap.hpp"
+#include "register_journal.hpp"
 #include "registers.hpp"
+#include "tile_cache.hpp"
+#include "write_journal.hpp"
 
 namespace lunar::nds {
 
@@ -69,32 +74,96 @@ class PPU {
 
       MasterBrightness master_bright;
 
-      bool capture_bg_and_3d;
+      bool capture_bg_and_3d = false;
+      bool powered = true;
+      bool window_scanline_enable[2] {};
+
+      // Writes a register, offset is relative to the start of the PPU's register block.
+      void WriteByte(uint offset, u8 value);
     } mmio;
 
+    /* Writes a PPU register. The render worker receives the write with the next scanline that is submitted.
+     * Register reads can still be served directly from mmio.
+     */
+    void WriteRegister(uint offset, u8 value) {
+      mmio.WriteByte(offset, value);
+      PushRegisterEvent(current_line, offset, value);
+    }
+
+    /* Powers the engine on or off (POWCNT1). A powered-off engine doesn't render any layers and displays a white screen.
+     * Like register writes, this takes effect with the next scanline that is submitted.
+     */
+    void SetPowered(bool powered) {
+      if (powered != mmio.powered) {
+        mmio.powered = powered;
+        PushRegisterEvent(current_line, EVENT_POWER, powered);
+      }
+    }
+
     void Reset();
 
+    // Output of the current frame, which is only complete once IsFrameRendered() returns true for the frame.
     auto GetOutput() const -> void const* {
       if(ogl.enabled) {
         return (void const*)ogl.output_texture->Handle();
       }
-      return &output[frame][0];
+      return frames[GetFrameSlot(frame_line)].buffer;
     }
 
-    auto GetOutputImageType() const -> VideoDevice::ImageType {
-      return ogl.enabled ? VideoDevice::ImageType::OpenGL : VideoDevice::ImageType::Software;
+    /* Frames are rendered asynchronously and the render worker may fall up to one frame behind the emulation.
+     * GetFrame() identifies the current frame, so that it can be presented once it has been rendered.
+     */
+    auto GetFrame() const -> s64 {
+      return frame_line;
+    }
+
+    auto IsFrameRendered(s64 frame) const -> bool {
+      return render_worker.line.load() >= frame + 192;
+    }
+
+    void WaitForFrame(s64 frame) {
+      render_worker.waiter.Wait(render_worker.line, [=](s64 line) {
+        return line >= frame + 192;
+      });
     }
 
-    void SwapBuffers() {
-      frame ^= 1;
+    /* Sets the buffer and pixel format that the next frame will be rendered to.
+     * If buffer is nullptr the frame is rendered to an internal buffer.
+     * Takes effect at the start of the next frame. The buffer must stay valid until the frame has been rendered.
+     */
+    void SetOutputBuffer(VideoDevice::PixelFormat format, void* buffer) {
+      output_format = format;
+      output_buffer = buffer;
     }
 
-    auto GetComposerOutput() -> u16 const* {
-      return &buffer_compose[0];
+    /* Enables reuse of composed scanlines whose registers and memory inputs did not change since they were last rendered.
+     * Takes effect at the start of the next frame.
+     */
+    void SetMemoization(bool enable) {
+      memo.enable_requested = enable;
+    }
+
+    /* Skips rendering of the next frame, its scanlines are only advanced through the register and memory journals.
+     * Takes effect at the start of the next frame. Frames that use display capture must not be skipped.
+     */
+    void SetSkipRendering(bool skip) {
+      skip_requested = skip;
+    }
+
+    auto GetOutputImageType() const -> VideoDevice::ImageType {
+      return ogl.enabled ? VideoDevice::ImageType::OpenGL : VideoDevice::ImageType::Software;
+    }
+
+    auto GetComposerOutput(int vcount) -> u16 const* {
+      return &buffer_compose[vcount][0];
     }
 
     void WaitForRenderWorker() {
-      while (render_worker.vcount <= render_worker.vcount_max) {}
+      s64 line_max = render_worker.line_max;
+
+      render_worker.waiter.Wait(render_worker.line, [=](s64 line) {
+        return line > line_max;
+      });
     }
 
     void OnWriteVRAM_BG(size_t address_lo, size_t address_hi) {
@@ -117,6 +186,19 @@ class PPU {
       OnRegionWrite(vram_lcdc, render_vram_lcdc, vram_lcdc_dirty, {address_lo, address_hi});
     }
 
+    /* Must be called before the CPU or DMA reads or writes LCDC VRAM.
+     * Captured scanlines are written back once the render worker has run them, which may be long after their HBlank.
+     * If a scanline of this frame captured to the accessed row and has not been written back yet, the captures are written back first.
+     * This way reads see the captured pixels and the write-back doesn't overwrite newer writes.
+     */
+    void OnAccessVRAM_LCDC(Region<64>& vram_lcdc, u32 address) {
+      u32 row = address >> 9;
+
+      if (unlikely(row < 1024 && display_capture.row_captured[row] >= frame_line + display_capture.write_back_next)) {
+        WriteBackDisplayCapture(vram_lcdc, true);
+      }
+    }
+
     void OnWritePRAM(size_t address_lo, size_t address_hi) {
       OnRegionWrite(pram, render_pram, pram_dirty, {address_lo, address_hi});
     }
@@ -125,7 +207,39 @@ class PPU {
       OnRegionWrite(oam, render_oam, oam_dirty, {address_lo, address_hi});
     }
 
-    void OnDrawScanlineBegin(u16 vcount, bool capture_bg_and_3d);
+    /* Display capture of a scanline into LCDC mapped VRAM (DISPCAPCNT), which PPU A runs on the render worker
+     * right after the scanline has been composed. Addresses are relative to the start of LCDC VRAM.
+     */
+    struct DisplayCapture {
+      enum class Source {
+        A = 0,
+        B = 1,
+        Blend = 2
+      };
+
+      bool enable = false;
+      Source source = Source::A;
+      bool source_a_3d = false; //< Source A is the 3D output instead of the composed scanline
+      int eva = 0;
+      int evb = 0;
+      int width = 0;
+      u32 read_address = 0;  //< Address of source B
+      u32 write_address = 0;
+    };
+
+    /* Copies scanlines that have been captured by the render worker to VRAM.
+     * If wait is true, waits for all submitted captures. This must happen before the next frame begins
+     * and before VRAM banks A to D are remapped, since the captures are written to the banks that are mapped at that time.
+     */
+    void WriteBackDisplayCapture(Region<64>& vram_lcdc, bool wait);
+
+    /* Composites the 2D layers of the current frame with the OpenGL 3D frame, unless that already has happened.
+     * If wait is false, this only happens once the frame has been rendered. Otherwise it waits for the frame.
+     * With OpenGL the output is incomplete until then. It must happen before the frame is presented and before the GPU renders the next 3D frame.
+     */
+    void MergeOpenGLFrame(bool wait);
+
+    void OnDrawScanlineBegin(u16 vcount, bool capture_bg_and_3d, DisplayCapture const& capture);
     void OnDrawScanlineEnd();
     void OnBlankScanlineBegin(u16 vcount);
 
@@ -161,44 +275,114 @@ class PPU {
     struct AddressRange {
       size_t lo = std::numeric_limits<size_t>::max();
       size_t hi = 0;
+    };
 
-      void Expand(AddressRange const& other) {
-        lo = std::min(lo, other.lo);
-        hi = std::max(hi, other.hi);
-      }
+    // OBJ layer of a scanline, stored as separate arrays so that the compositor can load them as vectors.
+    struct ObjectBuffer {
+      u16  color[256];
+      u8   priority[256];
+      bool alpha[256];
+      bool window[256];
     };
 
-    void AffineRenderLoop(
-      u16 vcount,
-      uint id,
-      int  width,
-      int  height,
-      std::function<void(int, int, int)> render_func
-    );
+    // Scratch buffers used while rendering a single scanline. Each render job has its own set.
+    struct LineBuffers {
+      MMIO mmio; //< Registers of the scanline
+      u16 bg[4][256];
+      u16 const* bg_line[4]; //< Scanline of each background, either from bg or read in place from the 3D frame
+      ObjectBuffer obj;
+      bool win[2][256];
+      u8 const* alpha_3d; //< Blend factors of the 3D layer, read in place from the 3D frame
+      bool obj_contains_alpha = false;
+      bool bg_culled[4] {}; //< Background is hidden by opaque layers above it and has not been rendered
+      TileCache* tile_cache;
+    };
+
+    // Renders an affine background line, fetch(x, y) returns the pixel at (x, y) within the background.
+    template<typename Fetch>
+    void AffineRenderLoop(MMIO const& mmio, uint id, u16* buffer, int width, int height, Fetch const& fetch);
+
+    template<bool wraparound, bool mosaic, typename Fetch>
+    void AffineRenderLoopTmpl(MMIO const& mmio, uint id, u16* buffer, int width, int height, Fetch const& fetch);
+
+    template<bool wraparound, typename Fetch>
+    void AffineRenderLoopIdentity(MMIO const& mmio, uint id, u16* buffer, int width, int height, Fetch const& fetch);
 
-    void RenderScanline(u16 vcount, bool capture_bg_and_3d);
+    void RenderScanline(u16 vcount, bool capture_bg_and_3d, LineBuffers& buffers);
     void RenderDisplayOff(u16 vcount);
-    void RenderNormal(u16 vcount);
-    void RenderVideoMemoryDisplay(u16 vcount);
-    void RenderMainMemoryDisplay(u16 vcount);
-    void RenderBackgroundsAndComposite(u16 vcount);
-    void RenderMasterBrightness(int vcount);
-
-    void RenderLayerText(uint id, u16 vcount);
-    void RenderLayerAffine(uint id, u16 vcount);
-    void RenderLayerExtended(uint id, u16 vcount);
-    void RenderLayerLarge(u16 vcount);
-    void RenderLayerOAM(u16 vcount);
-    void RenderWindow(uint id, u8 vcount);
+    void RenderNormal(u16 vcount, LineBuffers const& buffers);
+    void RenderVideoMemoryDisplay(u16 vcount, LineBuffers const& buffers);
+    void RenderMainMemoryDisplay(u16 vcount, LineBuffers const& buffers);
+    void RenderBackgroundsAndComposite(u16 vcount, LineBuffers& buffers);
+    void RenderLayer(uint id, u16 vcount, LineBuffers& buffers);
+    static bool IsOpaque(u16 const* buffer);
+    bool TryReuseComposedLine(u16 vcount, LineBuffers const& buffers);
+    void RenderOutputLine(u16 vcount, LineBuffers const& buffers, u16 const* source);
+    void RunDisplayCapture(u16 vcount);
+    auto TrackLCDCAccess(u16 vcount, s64 line) -> bool;
+
+    auto GetOutputLine(u16 vcount) -> void* {
+      auto format = render_frame->format;
+      auto bytes_per_pixel = format == VideoDevice::PixelFormat::RGB565 ||
+                             format == VideoDevice::PixelFormat::BGR555 ? sizeof(u16) : sizeof(u32);
+
+      return (u8*)render_frame->buffer + vcount * 256 * bytes_per_pixel;
+    }
+
+    void RenderLayerText(uint id, u16 vcount, LineBuffers& buffers);
+    void RenderLayerAffine(uint id, u16 vcount, LineBuffers& buffers);
+    void RenderLayerExtended(uint id, u16 vcount, LineBuffers& buffers);
+    void RenderLayerLarge(u16 vcount, LineBuffers& buffers);
+    void RenderLayerOAM(u16 vcount, LineBuffers& buffers);
+    void BuildSpriteTable();
+    void RenderWindow(uint id, u16 vcount, LineBuffers& buffers);
+    static void UpdateWindowScanlineEnable(MMIO& mmio, u8 line);
+
+    auto GetDecodedTileBG(LineBuffers& buffers, u32 address, bool is_8bpp, bool enable_extpal, uint palette, uint extpal_slot) -> u16 const*;
+    auto GetDecodedTileOBJ(LineBuffers& buffers, u32 address, bool is_8bpp, bool enable_extpal, uint palette) -> u16 const*;
+    void InvalidateDecodedTiles(u8 const* dst, size_t size);
 
     template<bool window, bool blending, bool opengl>
-    void ComposeScanlineTmpl(u16 vcount, int bg_min, int bg_max);
-    void ComposeScanline(u16 vcount, int bg_min, int bg_max);
-    void Blend(u16 vcount, u16& target1, u16 target2, BlendControl::Effect sfx);
+    void ComposeScanlineTmpl(u16 vcount, int bg_min, int bg_max, LineBuffers& buffers);
+    void ComposeScanline(u16 vcount, int bg_min, int bg_max, LineBuffers& buffers);
+    void ComposeScanlineKernel(u16 vcount, int bg_min, int bg_max, LineBuffers& buffers, bool window, bool blending);
+    void Blend(MMIO const& mmio, u16& target1, u16 target2, BlendControl::Effect sfx);
+
+    /* Register journal events that are not register writes.
+     * Their offsets are outside of the register block.
+     */
+    enum RegisterEvent : u8 {
+      EVENT_SCANLINE_BEGIN = 0x80, //< value: lower eight bits of VCOUNT
+      EVENT_SCANLINE_END = 0x81,
+      EVENT_VBLANK_BEGIN = 0x82,
+      EVENT_CAPTURE = 0x83, //< value: capture_bg_and_3d
+      EVENT_POWER = 0x84 //< value: powered
+    };
+
+    static void EndScanline(MMIO& mmio);
+    static void BeginVBlank(MMIO& mmio);
+    void PushRegisterEvent(s64 line, u8 offset, u8 value);
+    void ApplyRegisterEvent(u8 offset, u8 value);
+
+    void FlushRegisterJournal() {
+      register_journal.Flush([this](u8 offset, u8 value) {
+        ApplyRegisterEvent(offset, value);
+      });
+    }
 
     void SetupRenderWorker();
     void StopRenderWorker();
-    void SubmitScanline(u16 vcount, bool capture_bg_and_3d);
+    void RunRenderJob();
+    auto ClaimScanline(MMIO& line_mmio) -> s64;
+    void CompleteScanline(s64 line);
+    void SetCurrentScanline(u16 vcount);
+    void SubmitScanline(u16 vcount, bool capture_bg_and_3d, DisplayCapture const& capture);
+    void BeginFrame(bool capture_bg_and_3d);
+    void BeginRenderFrame(s64 line);
+
+    static auto GetFrameSlot(s64 line) -> int {
+      return (int)((line / 263) % kFrameCount);
+    }
     void RegisterMapUnmapCallbacks();
 
     static auto ConvertColor(u16 color) -> u32 {
@@ -213,128 +397,193 @@ class PPU {
       return *reinterpret_cast<u16 const*>(&render_pram[(palette * 16 + index) * 2]) & 0x7FFF;
     }
 
-    void DecodeTileLine4BPP(u16* buffer, u32 base, uint palette, uint number, uint y, bool flip) {
-      uint xor_x = flip ? 7 : 0;
-      u32  data  = atom::read<u32>(render_vram_bg, base + number * 32 + y * 4);
+    auto DecodeTilePixel8BPP_BG(u32 address, bool enable_extpal, uint palette, uint extpal_slot, int x, int y) -> u16 {
+      u8 index = atom::read<u8>(render_vram_bg, (address + (y * 8) + x) & (sizeof(render_vram_bg) - 1));
 
-      for (uint x = 0; x < 8; x++) {
-        auto index = data & 15;
-        buffer[x ^ xor_x] = index == 0 ? s_color_transparent : ReadPalette(palette, index);
-        data >>= 4;
+      if (index == 0) {
+        return s_color_transparent;
+      } else if (enable_extpal) {
+        return atom::read<u16>(render_extpal_bg, 0x2000 * extpal_slot + (palette * 256 + index) * sizeof(u16));
+      } else {
+        return ReadPalette(0, index);
       }
     }
 
-    void DecodeTileLine8BPP(u16* buffer, u32 base, uint palette, uint extpal_slot, uint number, uint y, bool flip) {
-      uint xor_x = flip ? 7 : 0;
-      u64  data  = atom::read<u64>(render_vram_bg, base + number * 64 + y * 8);
+    template<typename T>
+    static void CopyVRAM(T const& src, u8* dst, AddressRange const& range) {
+      ReadVRAM(src, &dst[range.lo], range);
+    }
 
-      for (uint x = 0; x < 8; x++) {
-        auto index = data & 0xFF;
-        if (index == 0) {
-          buffer[x ^ xor_x] = s_color_transparent;
-        } else if (mmio.dispcnt.enable_extpal_bg) {
-          buffer[x ^ xor_x] = atom::read<u16>(render_extpal_bg, 0x2000 * extpal_slot + (palette * 256 + index) * sizeof(u16));
-        } else {
-          buffer[x ^ xor_x] = ReadPalette(0, index);
-        }
-        data >>= 8;
-      }
+    template<typename T>
+    static void ReadVRAM(T const& src, u8* dst, AddressRange const& range) {
+      src.ReadBlock(range.lo, dst, range.hi - range.lo);
     }
 
-    auto DecodeTilePixel4BPP_OBJ(u32 address, uint palette, int x, int y) -> u16 {
-      u8 tuple = atom::read<u8>(render_vram_obj, address + (y * 4) + (x / 2));
-      u8 index = (x & 1) ? (tuple >> 4) : (tuple & 0xF);
+    static void ReadVRAM(u8 const* src, u8* dst, AddressRange const& range) {
+      memcpy(dst, &src[range.lo], range.hi - range.lo);
+    }
 
-      if (index == 0) {
-        return s_color_transparent;
-      } else {
-        return ReadPalette(palette, index);
-      }
+    // Copies the dirty spans of a region to its render-side copy and invalidates the data derived from them.
+    template<typename T, size_t copy_size>
+    void UpdateRenderCopy(T const& region, u8 (&copy_dst)[copy_size], DirtyBitmap<copy_size>& dirty) {
+      dirty.ForEachSpan([&](size_t lo, size_t hi) {
+        CopyVRAM(region, copy_dst, {lo, hi});
+        InvalidateDecodedTiles(&copy_dst[lo], hi - lo);
+      });
+      dirty.Clear();
     }
 
-    auto DecodeTilePixel8BPP_BG(u32 address, bool enable_extpal, uint palette, uint extpal_slot, int x, int y) -> u16 {
-      u8 index = atom::read<u8>(render_vram_bg, address + (y * 8) + x);
+    // Passes the dirty spans of a region to the render worker through the write journal, for when it is still busy.
+    template<typename T, size_t copy_size>
+    void JournalRenderCopy(T const& region, u8 (&copy_dst)[copy_size], DirtyBitmap<copy_size>& dirty, s64 line) {
+      dirty.ForEachSpan([&](size_t lo, size_t hi) {
+        JournalWrite(region, copy_dst, {lo, hi}, line);
+      });
+      dirty.Clear();
+    }
 
-      if (index == 0) {
-        return s_color_transparent;
-      } else if (enable_extpal && mmio.dispcnt.enable_extpal_bg) {
-        return atom::read<u16>(render_extpal_bg, 0x2000 * extpal_slot + (palette * 256 + index) * sizeof(u16));
+    template<typename T, size_t copy_size>
+    void JournalWrite(T const& region, u8 (&copy_dst)[copy_size], AddressRange const& range, s64 line) {
+      auto size = range.hi - range.lo;
+      auto data = write_journal.Push(line, &copy_dst[range.lo], size);
+
+      if (likely(data != nullptr)) {
+        ReadVRAM(region, data, range);
+        write_journal.Commit();
       } else {
-        return ReadPalette(0, index);
+        // The journal is full, wait for the render worker to catch up and update the copy directly.
+        WaitForRenderWorker();
+        FlushWriteJournal();
+        CopyVRAM(region, copy_dst, range);
+        InvalidateDecodedTiles(&copy_dst[range.lo], size);
+        UpdateSpriteTable();
       }
     }
 
-    auto DecodeTilePixel8BPP_OBJ(u32 address, uint palette, int x, int y) -> u16 {
-      u8 index = atom::read<u8>(render_vram_obj, address + (y * 8) + x);
+    template<typename T>
+    static auto GetMirrorSize(T const& region) -> size_t {
+      return region.GetMirrorSize();
+    }
 
-      if (index == 0) {
-        return s_color_transparent;
-      } else {
-        if (mmio.dispcnt.enable_extpal_obj) {
-          return atom::read<u16>(render_extpal_obj, ((palette * 256 + index) * sizeof(u16)) & 0x1FFF);
+    static auto GetMirrorSize(u8 const* region) -> size_t {
+      return std::numeric_limits<size_t>::max();
+    }
+
+    template<typename T, size_t copy_size>
+    void OnRegionWrite(T const& region, u8 (&copy_dst)[copy_size], DirtyBitmap<copy_size>& dirty, AddressRange write_range) {
+      // A region might be mirrored within its copy, in that case every mirror of the written range has changed.
+      auto mirror_size = std::min(copy_size, GetMirrorSize(region));
+
+      // Writes that cross the end of the region are clamped, since they would be rare and require splitting the range.
+      write_range.hi = std::min(mirror_size, (write_range.lo & (mirror_size - 1)) + (write_range.hi - write_range.lo));
+      write_range.lo &= mirror_size - 1;
+
+      for (size_t mirror = 0; mirror < copy_size; mirror += mirror_size) {
+        AddressRange range{write_range.lo + mirror, write_range.hi + mirror};
+
+        if (current_vcount < 192) {
+          JournalWrite(region, copy_dst, range, current_line);
         } else {
-          return ReadPalette(16, index);
+          dirty.Set(range.lo, range.hi);
         }
       }
     }
 
-    template<typename T>
-    static void CopyVRAM(T const& src, u8* dst, AddressRange const& range) {
-      for (size_t address = range.lo; address < range.hi; address++) {
-        dst[address] = src.template Read<u8>(address);
-      }
+    void ApplyWriteJournal(s64 line) {
+      write_journal.Apply(line, [this](u8 const* dst, size_t size) {
+        InvalidateDecodedTiles(dst, size);
+      });
+      UpdateSpriteTable();
     }
 
-    static void CopyVRAM(u8 const* src, u8* dst, AddressRange const& range) {
-      for (size_t address = range.lo; address < range.hi; address++) {
-        dst[address] = src[address];
-      }
+    void FlushWriteJournal() {
+      write_journal.Flush([this](u8 const* dst, size_t size) {
+        InvalidateDecodedTiles(dst, size);
+      });
+      UpdateSpriteTable();
     }
 
-    template<typename T>
-    void OnRegionWrite(T const& region, u8* copy_dst, AddressRange& dirty_range, AddressRange const& write_range) {
-      if (current_vcount < 192) {
-        WaitForRenderWorker();
-        CopyVRAM(region, copy_dst, write_range);
-      } else {
-        dirty_range.Expand(write_range);
+    void UpdateSpriteTable() {
+      if (sprite_table.dirty) {
+        BuildSpriteTable();
+        sprite_table.dirty = false;
       }
     }
 
     void Merge2DWithOpenGL3D();
 
     int id;
-    u32 output[2][256 * 192];
-    u16 buffer_compose[256];
-    u16 buffer_bg[4][256];
-    bool buffer_win[2][256];
-    bool window_scanline_enable[2];
-    int buffer_3d_alpha[256];
+    PPUKernels const& kernels;
+    /* Frames are rendered to a ring of three output buffers: while the emulation runs ahead,
+     * the render worker may still render the previous frame and the frame before it may not have been presented yet.
+     */
+    static constexpr int kFrameCount = 3;
+
+    // Per-frame state, which is latched at the start of each frame and read by the render worker.
+    struct Frame {
+      VideoDevice::PixelFormat format;
+      void* buffer; //< Buffer provided by the video device or an internal output buffer
+      Frame3D const* frame_3d; //< 3D frame that is composited into this frame, nullptr if it is composited by OpenGL
+      bool opengl; //< Scanlines are prepared for compositing with OpenGL rendered 3D
+      bool memoize;
+      bool skip; //< Nothing is rendered for this frame
+    } frames[kFrameCount];
+
+    Frame const* render_frame; //< Frame that the render worker currently renders (render worker only)
+
+    u32 output[kFrameCount][256 * 192]; //< Internal output buffers, large enough for any pixel format
+    bool skip_requested = false; //< Skip rendering of the next frame
+    VideoDevice::PixelFormat output_format = VideoDevice::PixelFormat::BGRA8888; //< Pixel format for the next frame
+    void* output_buffer = nullptr; //< Buffer provided by the video device for the next frame
+    u16 buffer_compose[192][256];
 
     // buffers for OpenGL 3D-to-2D compositing
     u32 buffer_ogl_color[2][256 * 192];
     u16 buffer_ogl_attribute[256 * 192];
 
-    struct ObjectPixel {
-      u16 color;
-      u8  priority;
-      unsigned alpha  : 1;
-      unsigned window : 1;
-    } buffer_obj[256];
-
-    bool line_contains_alpha_obj = false;
+    /* Scanlines are rendered by up to kMaxRenderJobs concurrent jobs on the shared thread pool.
+     * Scanlines may complete out of order, but a scanline is only started once
+     * the memory writes that happened before it was submitted have been applied.
+     * Scanlines are numbered continuously across frames, so that the emulation can begin
+     * the next frame while the render worker still renders the previous one.
+     */
+    static constexpr int kMaxRenderJobs = 4;
 
     struct RenderWorker {
-      std::atomic_int vcount;
-      std::atomic_int vcount_max;
-      std::atomic_bool running = false;
-      std::condition_variable cv;
+      std::atomic<s64> line = 0; //< All scanlines before this one have been rendered
+      std::atomic<s64> line_max = -1; //< Last submitted scanline
       std::mutex mutex;
-      bool ready;
-      std::thread thread;
+      s64 line_next = 0; //< Next scanline to be claimed by a render job (guarded by mutex)
+      std::atomic<int> active_jobs = 0; //< Number of render jobs queued or running (modified under mutex)
+      bool done[263] {}; //< Scanlines at or after `line` that have been rendered, indexed by the vertical counter (guarded by mutex)
+      u8 free_tile_caches = (1 << kMaxRenderJobs) - 1; //< Tile caches not used by a render job (guarded by mutex)
+      AdaptiveWaiter waiter;
     } render_worker;
 
-    MMIO mmio_copy[263];
+    /* Display captures are written to the render-side LCDC copy by the render worker and copied to VRAM afterwards.
+     * Scanlines that read LCDC rows which a capture that might still be in progress writes to (or vice versa) are rendered in order.
+     */
+    struct DisplayCaptureState {
+      DisplayCapture lines[192]; //< Capture of each visible scanline, set when the scanline is submitted
+      bool ordered[192]; //< The scanline may only be claimed once all previous scanlines have been rendered
+      u16 output[192][256]; //< Captured pixels, until they have been written back to VRAM
+      int write_back_next; //< First visible scanline of the current frame that has not been written back yet
+      int write_back_end;
+      s64 row_read[1024]; //< Last scanline that read each 512-byte row of LCDC blocks A to D
+      s64 row_captured[1024]; //< Last scanline that captured to each row
+    } display_capture;
+
+    // Decoded tile caches, one for each concurrent render job.
+    TileCache tile_caches[kMaxRenderJobs];
+
+    // Registers as seen by the render worker, updated from the register journal when a scanline is claimed.
+    MMIO render_mmio;
+
+    // Register writes and scanline events, in the order they happened on the emulator thread
+    RegisterJournal<4096> register_journal;
+
+    // VRAM, PRAM and OAM writes that happened during the visible scanlines
+    WriteJournal<8192, 524288> write_journal;
 
     Region<32> const& vram_bg;  //< Background tile, map and bitmap data
     Region<16> const& vram_obj; //< OBJ tile and bitmap data
@@ -353,21 +602,79 @@ class PPU {
     u8 render_pram[0x400];
     u8 render_oam[0x400];
 
-    // Lowest and highest dirty VRAM addresses
-    AddressRange vram_bg_dirty;
-    AddressRange vram_obj_dirty;
-    AddressRange extpal_bg_dirty;
-    AddressRange extpal_obj_dirty;
-    AddressRange vram_lcdc_dirty;
-    AddressRange pram_dirty;
-    AddressRange oam_dirty;
+    /* OBJ attributes decoded from the render-side OAM copy and the OBJs that intersect each scanline.
+     * The table is rebuilt after the copy has been written to, which only happens while no scanline is being rendered.
+     */
+    struct SpriteTable {
+      struct Entry {
+        s16 x; //< Center of the view rectangle
+        s16 y;
+        s16 half_width; //< Half size of the view rectangle (doubled for double-size affine OBJs)
+        s16 half_height;
+        u8  width; //< Size of the OBJ in pixels
+        u8  height;
+        u8  mode;
+        u8  priority;
+        u8  palette;
+        bool mosaic;
+        bool is_256;
+        bool flip_h;
+        bool flip_v;
+        u16 number;
+        s16 transform[4];
+      } entries[128];
+
+      u64 lines[192][2]; //< One bit per OBJ that intersects the scanline
+      bool dirty = true;
+    } sprite_table;
+
+    /* Generation counters of the render-side copies, used to validate decoded tiles.
+     * They are only modified while no scanline is being rendered.
+     */
+    struct Generations {
+      static constexpr int kPageShift = 9;
+
+      u32 vram_bg[sizeof(render_vram_bg) >> kPageShift] {};
+      u32 vram_obj[sizeof(render_vram_obj) >> kPageShift] {};
+      u32 extpal_bg[sizeof(render_extpal_bg) >> kPageShift] {};  //< One counter per 256-color palette
+      u32 extpal_obj[sizeof(render_extpal_obj) >> kPageShift] {}; //< One counter per 256-color palette
+      u32 pram[32] {}; //< One counter per 16-color palette
+      u32 pram_bg = 0;  //< Any BG palette changed
+      u32 pram_obj = 0; //< Any OBJ palette changed
+      u32 bg = 0;  //< Any BG VRAM or extended palette changed
+      u32 obj = 0; //< Any OBJ VRAM, extended palette or OAM changed
+    } generation;
+
+    /* Inputs that each composed scanline (buffer_compose) was last rendered from.
+     * A line is reused if its MMIO copy and the generations of the memory it reads did not change.
+     */
+    struct Memoization {
+      struct Line {
+        MMIO mmio; //< Compared bytewise, excluding registers that are not used for composing
+        u32 generation_bg;
+        u32 generation_obj;
+        bool valid = false;
+      } lines[192];
+
+      bool enabled = false;
+      bool enable_requested = false;
+    } memo;
+
+    // Parts of VRAM, PRAM and OAM that were written to outside of the visible scanlines
+    DirtyBitmap<sizeof(render_vram_bg)> vram_bg_dirty;
+    DirtyBitmap<sizeof(render_vram_obj)> vram_obj_dirty;
+    DirtyBitmap<sizeof(render_extpal_bg)> extpal_bg_dirty;
+    DirtyBitmap<sizeof(render_extpal_obj)> extpal_obj_dirty;
+    DirtyBitmap<sizeof(render_vram_lcdc)> vram_lcdc_dirty;
+    DirtyBitmap<sizeof(render_pram)> pram_dirty;
+    DirtyBitmap<sizeof(render_oam)> oam_dirty;
 
     int current_vcount;
+    s64 current_line; //< Number of the current scanline, counted continuously across frames
+    s64 frame_line; //< Number of the first scanline of the current frame
 
     GPU* gpu;
 
-    int frame = 0;
-
     // For compositing with OpenGL rendered 3D
     struct OpenGL {
       bool enabled = false;
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <atom/integer.hpp>
+#include <atomic>
+#include <cstddef>
+#include <limits>
+
+namespace lunar::nds {
+
+/* Single-producer single-consumer log of PPU register writes.
+ * The emulator thread appends each write together with the scanline it happened on,
+ * the render worker replays the writes on its own copy of the registers before it renders the next scanline.
+ * Besides register writes the log also contains events that update the internal state of the PPU, e.g. the end of a scanline.
+ * Apply() may be called from different threads over time, as long as the calls are serialized.
+ */
+template<size_t capacity>
+class RegisterJournal {
+  public:
+    RegisterJournal() {
+      Reset();
+    }
+
+    // Only safe to call while the consumer is idle.
+    void Reset() {
+      head = 0;
+      tail = 0;
+    }
+
+    // Appends a write that happened on the scanline `line`. Returns false if the journal is full.
+    bool Push(s64 line, u8 offset, u8 value) {
+      size_t position = head.load(std::memory_order_relaxed);
+
+      if (position - tail.load(std::memory_order_acquire) == capacity) {
+        return false;
+      }
+
+      auto& entry = entries[position % capacity];
+      entry.line = line;
+      entry.offset = offset;
+      entry.value = value;
+
+      head.store(position + 1, std::memory_order_release);
+      return true;
+    }
+
+    /* Replays all writes that happened on or before the scanline `line`, in the order they were pushed.
+     * on_write(offset, value) is called for each write.
+     */
+    template<typename Callback>
+    void Apply(s64 line, Callback&& on_write) {
+      size_t position = tail.load(std::memory_order_relaxed);
+      size_t end = head.load(std::memory_order_acquire);
+
+      while (position != end) {
+        auto const& entry = entries[position % capacity];
+
+        if (entry.line > line) {
+          break;
+        }
+
+        on_write(entry.offset, entry.value);
+        position++;
+      }
+
+      tail.store(position, std::memory_order_release);
+    }
+
+    // Replays all remaining writes regardless of their scanline.
+    template<typename Callback>
+    void Flush(Callback&& on_write) {
+      Apply(std::numeric_limits<s64>::max(), on_write);
+    }
+
+  private:
+    struct Entry {
+      s64 line;
+      u8 offset;
+      u8 value;
+    } entries[capacity];
+
+    std::atomic<size_t> head; //< Producer-owned write position
+    std::atomic<size_t> tail; //< Consumer-owned read position
+};
+
+} // namespace lunar::nds
@@ -93,7 +93,6 @@ struct RotateScaleParameter {
 struct WindowRange {
   u8 min;
   u8 max;
-  bool _changed;
 
   void Reset();
   void WriteByte(uint offset, u8 value);
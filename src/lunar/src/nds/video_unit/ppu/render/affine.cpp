@@ -5,79 +5,116 @@
  * found in the LICENSE file.
  */
 
+#include <algorithm>
+
 #include "nds/video_unit/ppu/ppu.hpp"
 
 namespace lunar::nds {
 
-void PPU::AffineRenderLoop(
-  u16 vcount,
-  uint id,
-  int  width,
-  int  height,
-  std::function<void(int, int, int)> render_func
-) {
-  auto const& mmio = mmio_copy[vcount];
-  auto const& bg = mmio.bgcnt[2 + id];
-  auto const& mosaic = mmio.mosaic.bg;
-  u16* buffer = buffer_bg[2 + id];
-    
+static constexpr u32 kVRAMBGMask = 0x7FFFF;
+
+template<bool wraparound, bool mosaic, typename Fetch>
+void PPU::AffineRenderLoopTmpl(MMIO const& mmio, uint id, u16* buffer, int width, int height, Fetch const& fetch) {
+  int mosaic_size = mmio.mosaic.bg.size_x;
+
   s32 ref_x = mmio.bgx[id]._current;
   s32 ref_y = mmio.bgy[id]._current;
   s16 pa = mmio.bgpa[id].value;
   s16 pc = mmio.bgpc[id].value;
-    
+
   int mosaic_x = 0;
-    
+
   for (int _x = 0; _x < 256; _x++) {
     s32 x = ref_x >> 8;
     s32 y = ref_y >> 8;
-      
-    if (bg.enable_mosaic) {
-      if (++mosaic_x == mosaic.size_x) {
-        ref_x += mosaic.size_x * pa;
-        ref_y += mosaic.size_x * pc;
+
+    if constexpr (mosaic) {
+      if (++mosaic_x == mosaic_size) {
+        ref_x += mosaic_size * pa;
+        ref_y += mosaic_size * pc;
         mosaic_x = 0;
       }
     } else {
       ref_x += pa;
       ref_y += pc;
     }
-      
-    if (bg.wraparound) {
-      if (x >= width) {
-        x %= width;
-      } else if (x < 0) {
-        x = width + (x % width);
-      }
-      
-      if (y >= height) {
-        y %= height;
-      } else if (y < 0) {
-        y = height + (y % height);
-      }
-    } else if (x >= width || y >= height || x < 0 || y < 0) {
+
+    // The dimensions of all affine backgrounds are powers of two.
+    if constexpr (wraparound) {
+      x &= width - 1;
+      y &= height - 1;
+    } else if ((u32)x >= (u32)width || (u32)y >= (u32)height) {
       buffer[_x] = s_color_transparent;
       continue;
     }
-    
-    render_func(_x, (int)x, (int)y);
+
+    buffer[_x] = fetch(x, y);
   }
 }
 
-void PPU::RenderLayerAffine(uint id, u16 vcount) {
-  auto const& mmio = mmio_copy[vcount];
+template<bool wraparound, typename Fetch>
+void PPU::AffineRenderLoopIdentity(MMIO const& mmio, uint id, u16* buffer, int width, int height, Fetch const& fetch) {
+
+  // Without rotation or scaling the line is a plain copy of one row of the background.
+  s32 x = mmio.bgx[id]._current >> 8;
+  s32 y = mmio.bgy[id]._current >> 8;
+
+  if constexpr (wraparound) {
+    y &= height - 1;
+
+    for (int _x = 0; _x < 256; _x++) {
+      buffer[_x] = fetch((x + _x) & (width - 1), y);
+    }
+  } else {
+    if ((u32)y >= (u32)height) {
+      std::fill_n(buffer, 256, s_color_transparent);
+      return;
+    }
+
+    for (int _x = 0; _x < 256; _x++) {
+      buffer[_x] = (u32)(x + _x) < (u32)width ? fetch(x + _x, y) : s_color_transparent;
+    }
+  }
+}
+
+template<typename Fetch>
+void PPU::AffineRenderLoop(MMIO const& mmio, uint id, u16* buffer, int width, int height, Fetch const& fetch) {
+  auto const& bg = mmio.bgcnt[2 + id];
+
+  // A mosaic width of one pixel has no effect.
+  bool mosaic = bg.enable_mosaic && mmio.mosaic.bg.size_x != 1;
+
+  if (!mosaic && mmio.bgpa[id].value == 0x100 && mmio.bgpc[id].value == 0) {
+    if (bg.wraparound) {
+      AffineRenderLoopIdentity<true>(mmio, id, buffer, width, height, fetch);
+    } else {
+      AffineRenderLoopIdentity<false>(mmio, id, buffer, width, height, fetch);
+    }
+    return;
+  }
+
+  switch ((bg.wraparound ? 1 : 0) | (mosaic ? 2 : 0)) {
+    case 0: AffineRenderLoopTmpl<false, false>(mmio, id, buffer, width, height, fetch); break;
+    case 1: AffineRenderLoopTmpl<true,  false>(mmio, id, buffer, width, height, fetch); break;
+    case 2: AffineRenderLoopTmpl<false, true >(mmio, id, buffer, width, height, fetch); break;
+    case 3: AffineRenderLoopTmpl<true,  true >(mmio, id, buffer, width, height, fetch); break;
+  }
+}
+
+void PPU::RenderLayerAffine(uint id, u16 vcount, LineBuffers& buffers) {
+  auto const& mmio = buffers.mmio;
   auto const& bg = mmio.bgcnt[2 + id];
   
-  u16* buffer = buffer_bg[2 + id];
+  u16* buffer = buffers.bg[2 + id];
   
   int size = 128 << bg.size;
   int block_width = 16 << bg.size;
   u32 map_base  = mmio.dispcnt.map_block  * 65536 + bg.map_block  * 2048;
   u32 tile_base = mmio.dispcnt.tile_block * 65536 + bg.tile_block * 16384;
   
-  AffineRenderLoop(vcount, id, size, size, [&](int line_x, int x, int y) {
-    auto tile_number = atom::read<u8>(render_vram_bg, map_base + (y >> 3) * block_width + (x >> 3));
-    buffer[line_x] = DecodeTilePixel8BPP_BG(
+  AffineRenderLoop(mmio, id, buffer, size, size, [&](int x, int y) -> u16 {
+    auto tile_number = atom::read<u8>(render_vram_bg, (map_base + (y >> 3) * block_width + (x >> 3)) & kVRAMBGMask);
+    return DecodeTilePixel8BPP_BG(
       tile_base + tile_number * 64,
       false,
       0,
@@ -88,11 +125,11 @@ void PPU::RenderLayerAffine(uint id, u16 vcount) {
   });
 }
 
-void PPU::RenderLayerExtended(uint id, u16 vcount) {
-  auto const& mmio = mmio_copy[vcount];
+void PPU::RenderLayerExtended(uint id, u16 vcount, LineBuffers& buffers) {
+  auto const& mmio = buffers.mmio;
   auto const& bg = mmio.bgcnt[2 + id];
 
-  u16* buffer = buffer_bg[2 + id];
+  u16* buffer = buffers.bg[2 + id];
 
   if (bg.full_palette) {
     int width;
@@ -107,23 +144,21 @@ void PPU::RenderLayerExtended(uint id, u16 vcount) {
 
     if (bg.tile_block & 1) {
       // Rotate/Scale direct color bitmap
-      AffineRenderLoop(vcount, id, width, height, [&](int line_x, int x, int y) {
-        u16 color = atom::read<u16>(render_vram_bg, bg.map_block * 16384 + (y * width + x) * 2);
+      AffineRenderLoop(mmio, id, buffer, width, height, [&](int x, int y) -> u16 {
+        u16 color = atom::read<u16>(render_vram_bg, (bg.map_block * 16384 + (y * width + x) * 2) & kVRAMBGMask);
         if (color & 0x8000) {
-          buffer[line_x] = color & 0x7FFF;
-        } else {
-          buffer[line_x] = s_color_transparent;
+          return color & 0x7FFF;
         }
+        return s_color_transparent;
       });
     } else {
       // Rotate/Scale 256-color bitmap
-      AffineRenderLoop(vcount, id, width, height, [&](int line_x, int x, int y) {
-        u8 index = atom::read<u8>(render_vram_bg, bg.map_block * 16384 + y * width + x);
+      AffineRenderLoop(mmio, id, buffer, width, height, [&](int x, int y) -> u16 {
+        u8 index = atom::read<u8>(render_vram_bg, (bg.map_block * 16384 + y * width + x) & kVRAMBGMask);
         if (index == 0) {
-          buffer[line_x] = s_color_transparent;
-        } else {
-          buffer[line_x] = ReadPalette(0, index);
+          return s_color_transparent;
         }
+        return ReadPalette(0, index);
       });
     }
 
@@ -134,8 +169,8 @@ void PPU::RenderLayerExtended(uint id, u16 vcount) {
     u32 map_base  = mmio.dispcnt.map_block  * 65536 + bg.map_block  * 2048;
     u32 tile_base = mmio.dispcnt.tile_block * 65536 + bg.tile_block * 16384;
       
-    AffineRenderLoop(vcount, id, size, size, [&](int line_x, int x, int y) {
-      u16 encoder = atom::read<u16>(render_vram_bg, map_base + ((y >> 3) * block_width + (x >> 3)) * 2);
+    AffineRenderLoop(mmio, id, buffer, size, size, [&](int x, int y) -> u16 {
+      u16 encoder = atom::read<u16>(render_vram_bg, (map_base + ((y >> 3) * block_width + (x >> 3)) * 2) & kVRAMBGMask);
       int number  = encoder & 0x3FF;
       int palette = encoder >> 12;
       int tile_x = x & 7;
@@ -144,25 +179,26 @@ void PPU::RenderLayerExtended(uint id, u16 vcount) {
       if (encoder & (1 << 10)) tile_x = 7 - tile_x;
       if (encoder & (1 << 11)) tile_y = 7 - tile_y;
  
-      buffer[line_x] = DecodeTilePixel8BPP_BG(tile_base + number * 64, true, palette, 2 + id, tile_x, tile_y);
+      return DecodeTilePixel8BPP_BG(tile_base + number * 64, mmio.dispcnt.enable_extpal_bg, palette, 2 + id, tile_x, tile_y);
     });
   }
 }
 
-void PPU::RenderLayerLarge(u16 vcount) {
-  auto const& mmio = mmio_copy[vcount];
+void PPU::RenderLayerLarge(u16 vcount, LineBuffers& buffers) {
+  auto const& mmio = buffers.mmio;
   auto const& bg = mmio.bgcnt[2];
 
   int width = 512 << (bg.size & 1);
   int height = 1024 >> (bg.size & 1);
 
-  AffineRenderLoop(vcount, 0, width, height, [&](int line_x, int x, int y) {
+  u16* buffer = buffers.bg[2];
+
+  AffineRenderLoop(mmio, 0, buffer, width, height, [&](int x, int y) -> u16 {
     u8 index = atom::read<u8>(render_vram_bg, y * width + x);
     if (index == 0) {
-      buffer_bg[2][line_x] = s_color_transparent;
-    } else {
-      buffer_bg[2][line_x] = ReadPalette(0, index);
+      return s_color_transparent;
     }
+    return ReadPalette(0, index);
   });
 }
 
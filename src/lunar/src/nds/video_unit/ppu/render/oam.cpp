@@ -5,6 +5,10 @@
  * found in the LICENSE file.
  */
 
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
 #include "nds/video_unit/ppu/ppu.hpp"
 
 namespace lunar::nds {
@@ -40,24 +44,12 @@ const int PPU::s_obj_size[4][4][2] = {
   }
 };
 
-void PPU::RenderLayerOAM(u16 vcount) {
-  auto const& mmio = mmio_copy[vcount];
-
-  s16 transform[4];
-
-  int tile_num;
-  u16 pixel;
-
-  line_contains_alpha_obj = false;
+void PPU::BuildSpriteTable() {
+  std::memset(sprite_table.lines, 0, sizeof(sprite_table.lines));
 
-  for (int x = 0; x < 256; x++) {
-    buffer_obj[x].priority = 4;
-    buffer_obj[x].color = s_color_transparent;
-    buffer_obj[x].alpha = 0;
-    buffer_obj[x].window = 0;
-  }
+  for (int i = 0; i < 128; i++) {
+    int offset = i * 8;
 
-  for (s32 offset = 0; offset <= 127 * 8; offset += 8) {
     // Check if OBJ is disabled (affine=0, attr0bit9=1)
     if ((render_oam[offset + 1] & 3) == 2) {
       continue;
@@ -67,16 +59,12 @@ void PPU::RenderLayerOAM(u16 vcount) {
     u16 attr1 = (render_oam[offset + 3] << 8) | render_oam[offset + 2];
     u16 attr2 = (render_oam[offset + 5] << 8) | render_oam[offset + 4];
 
-    int width;
-    int height;
+    auto& entry = sprite_table.entries[i];
 
     s32 x = attr1 & 0x1FF;
     s32 y = attr0 & 0x0FF;
-    int shape  =  attr0 >> 14;
-    int size   =  attr1 >> 14;
-    int prio   = (attr2 >> 10) & 3;
-    int mode   = (attr0 >> 10) & 3;
-    int mosaic = (attr0 >> 12) & 1;
+    int shape = attr0 >> 14;
+    int size  = attr1 >> 14;
 
     if (x >= 256) x -= 512;
     if (y >= 192) y -= 256;
@@ -85,8 +73,8 @@ void PPU::RenderLayerOAM(u16 vcount) {
     int attr0b9 = (attr0 >> 9) & 1;
 
     // Decode OBJ width and height.
-    width  = s_obj_size[shape][size][0];
-    height = s_obj_size[shape][size][1];
+    int width  = s_obj_size[shape][size][0];
+    int height = s_obj_size[shape][size][1];
 
     int half_width  = width / 2;
     int half_height = height / 2;
@@ -100,10 +88,10 @@ void PPU::RenderLayerOAM(u16 vcount) {
       int group = ((attr1 >> 9) & 0x1F) << 5;
 
       // Read transform matrix.
-      transform[0] = (render_oam[group + 0x7 ] << 8) | render_oam[group + 0x6 ];
-      transform[1] = (render_oam[group + 0xF ] << 8) | render_oam[group + 0xE ];
-      transform[2] = (render_oam[group + 0x17] << 8) | render_oam[group + 0x16];
-      transform[3] = (render_oam[group + 0x1F] << 8) | render_oam[group + 0x1E];
+      entry.transform[0] = (render_oam[group + 0x7 ] << 8) | render_oam[group + 0x6 ];
+      entry.transform[1] = (render_oam[group + 0xF ] << 8) | render_oam[group + 0xE ];
+      entry.transform[2] = (render_oam[group + 0x17] << 8) | render_oam[group + 0x16];
+      entry.transform[3] = (render_oam[group + 0x1F] << 8) | render_oam[group + 0x1E];
 
       // Check double-size flag. Doubles size of the view rectangle.
       if (attr0b9) {
@@ -117,108 +105,171 @@ void PPU::RenderLayerOAM(u16 vcount) {
        * [ 1 0 ]
        * [ 0 1 ]
        */
-      transform[0] = 0x100;
-      transform[1] = 0;
-      transform[2] = 0;
-      transform[3] = 0x100;
+      entry.transform[0] = 0x100;
+      entry.transform[1] = 0;
+      entry.transform[2] = 0;
+      entry.transform[3] = 0x100;
     }
 
-    // Bail out if scanline is outside OBJ's view rectangle.
-    if (vcount < (y - half_height) || vcount >= (y + half_height)) {
-      continue;
+    entry.x = x;
+    entry.y = y;
+    entry.half_width  = half_width;
+    entry.half_height = half_height;
+    entry.width    = width;
+    entry.height   = height;
+    entry.mode     = (attr0 >> 10) & 3;
+    entry.priority = (attr2 >> 10) & 3;
+    entry.palette  = (attr2 >> 12) + 16;
+    entry.mosaic   = (attr0 >> 12) & 1;
+    entry.is_256   = (attr0 >> 13) & 1;
+    entry.flip_h   = !affine && (attr1 & (1 << 12));
+    entry.flip_v   = !affine && (attr1 & (1 << 13));
+    entry.number   = attr2 & 0x3FF;
+
+    // Add the OBJ to the scanlines that intersect its view rectangle.
+    int line_min = std::max(y - half_height, 0);
+    int line_max = std::min(y + half_height, 192);
+
+    for (int line = line_min; line < line_max; line++) {
+      sprite_table.lines[line][i >> 6] |= 1ULL << (i & 63);
     }
+  }
+}
 
-    s16 local_y = vcount - y;
-    int number  =  attr2 & 0x3FF;
-    int palette = (attr2 >> 12) + 16;
-    int flip_h  = !affine && (attr1 & (1 << 12));
-    int flip_v  = !affine && (attr1 & (1 << 13));
-    int is_256  = (attr0 >> 13) & 1;
+void PPU::RenderLayerOAM(u16 vcount, LineBuffers& buffers) {
+  auto const& mmio = buffers.mmio;
 
-    int mosaic_x = 0;
+  int tile_num;
+  u16 pixel;
 
-    if (mosaic) {
-      mosaic_x = (x - half_width) % mmio.mosaic.obj.size_x;
-      local_y -= mmio.mosaic.obj._counter_y;
-    }
+  auto& buffer_obj = buffers.obj;
 
-    // Render OBJ scanline. 
-    for (int local_x = -half_width; local_x <= half_width; local_x++) {
-      int _local_x = local_x - mosaic_x;
-      int global_x = local_x + x;
+  // Visit the OBJs that intersect this scanline in OAM order.
+  for (int word = 0; word < 2; word++) {
+    u64 bits = sprite_table.lines[vcount][word];
 
-      if (mosaic && (++mosaic_x == mmio.mosaic.obj.size_x)) {
-        mosaic_x = 0;
-      }
+    while (bits != 0) {
+      int index = word * 64 + std::countr_zero(bits);
 
-      if (global_x < 0 || global_x >= 256) {
-        continue;
-      }
+      bits &= bits - 1;
 
-      int tex_x = ((transform[0] * _local_x + transform[1] * local_y) >> 8) + (width / 2);
-      int tex_y = ((transform[2] * _local_x + transform[3] * local_y) >> 8) + (height / 2);
+      auto const& entry = sprite_table.entries[index];
 
-      // Check if transformed coordinates are inside bounds.
-      if (tex_x >= width || tex_y >= height ||
-        tex_x < 0 || tex_y < 0) {
-        continue;
-      }
+      s32 x = entry.x;
+      s32 y = entry.y;
+      int width  = entry.width;
+      int height = entry.height;
+      int half_width = entry.half_width;
+      int prio   = entry.priority;
+      int mode   = entry.mode;
+      int mosaic = entry.mosaic;
 
-      if (flip_h) tex_x = width  - tex_x - 1;
-      if (flip_v) tex_y = height - tex_y - 1;
+      s16 const* transform = entry.transform;
 
-      int tile_x  = tex_x % 8;
-      int tile_y  = tex_y % 8;
-      int block_x = tex_x / 8;
-      int block_y = tex_y / 8;
+      s16 local_y = vcount - y;
+      int number  = entry.number;
+      int palette = entry.palette;
+      int flip_h  = entry.flip_h;
+      int flip_v  = entry.flip_v;
+      int is_256  = entry.is_256;
 
-      if (mode == OBJ_BITMAP) {
-        // TODO: Attr 2, Bit 12-15 is used as Alpha-OAM value (instead of as palette setting).
-        if (mmio.dispcnt.bitmap_obj.mapping == DisplayControl::Mapping::OneDimensional) {
-          pixel = atom::read<u16>(render_vram_obj, (number * (64 << mmio.dispcnt.bitmap_obj.boundary) + tex_y * width + tex_x) * 2);
-        } else {
-          auto dimension = mmio.dispcnt.bitmap_obj.dimension;
-          auto mask = (16 << dimension) - 1;
+      int mosaic_x = 0;
+
+      // Decoded tile that the previous pixel was fetched from.
+      int last_tile_num = -1;
+      u16 const* tile_pixels = nullptr;
+
+      if (mosaic) {
+        mosaic_x = (x - half_width) % mmio.mosaic.obj.size_x;
+        local_y -= mmio.mosaic.obj._counter_y;
+      }
 
-          pixel = atom::read<u16>(render_vram_obj, ((number & ~mask) * 64 + (number & mask) * 8 + tex_y * (128 << dimension) + tex_x) * 2);
+      // Render OBJ scanline. 
+      for (int local_x = -half_width; local_x <= half_width; local_x++) {
+        int _local_x = local_x - mosaic_x;
+        int global_x = local_x + x;
+
+        if (mosaic && (++mosaic_x == mmio.mosaic.obj.size_x)) {
+          mosaic_x = 0;
         }
 
-        if ((pixel & 0x8000) == 0) {
-          pixel = s_color_transparent;
+        if (global_x < 0 || global_x >= 256) {
+          continue;
         }
-      } else if (is_256) {
-        if (mmio.dispcnt.tile_obj.mapping == DisplayControl::Mapping::OneDimensional) {
-          tile_num = (number << mmio.dispcnt.tile_obj.boundary) + block_y * (width / 4);
-        } else {
-          tile_num = (number & ~1) + block_y * 32;
+
+        int tex_x = ((transform[0] * _local_x + transform[1] * local_y) >> 8) + (width / 2);
+        int tex_y = ((transform[2] * _local_x + transform[3] * local_y) >> 8) + (height / 2);
+
+        // Check if transformed coordinates are inside bounds.
+        if (tex_x >= width || tex_y >= height ||
+          tex_x < 0 || tex_y < 0) {
+          continue;
         }
 
-        tile_num += block_x * 2;
+        if (flip_h) tex_x = width  - tex_x - 1;
+        if (flip_v) tex_y = height - tex_y - 1;
+
+        int tile_x  = tex_x % 8;
+        int tile_y  = tex_y % 8;
+        int block_x = tex_x / 8;
+        int block_y = tex_y / 8;
+
+        if (mode == OBJ_BITMAP) {
+          // TODO: Attr 2, Bit 12-15 is used as Alpha-OAM value (instead of as palette setting).
+          if (mmio.dispcnt.bitmap_obj.mapping == DisplayControl::Mapping::OneDimensional) {
+            pixel = atom::read<u16>(render_vram_obj, (number * (64 << mmio.dispcnt.bitmap_obj.boundary) + tex_y * width + tex_x) * 2);
+          } else {
+            auto dimension = mmio.dispcnt.bitmap_obj.dimension;
+            auto mask = (16 << dimension) - 1;
+
+            pixel = atom::read<u16>(render_vram_obj, ((number & ~mask) * 64 + (number & mask) * 8 + tex_y * (128 << dimension) + tex_x) * 2);
+          }
+
+          if ((pixel & 0x8000) == 0) {
+            pixel = s_color_transparent;
+          }
+        } else if (is_256) {
+          if (mmio.dispcnt.tile_obj.mapping == DisplayControl::Mapping::OneDimensional) {
+            tile_num = (number << mmio.dispcnt.tile_obj.boundary) + block_y * (width / 4);
+          } else {
+            tile_num = (number & ~1) + block_y * 32;
+          }
+
+          tile_num += block_x * 2;
 
-        pixel = DecodeTilePixel8BPP_OBJ(tile_num * 32, palette, tile_x, tile_y);
-      } else {
-        if (mmio.dispcnt.tile_obj.mapping == DisplayControl::Mapping::OneDimensional) {
-          tile_num = (number << mmio.dispcnt.tile_obj.boundary) + block_y * (width / 8);
+          if (tile_num != last_tile_num) {
+            tile_pixels = GetDecodedTileOBJ(buffers, tile_num * 32, true, mmio.dispcnt.enable_extpal_obj, palette);
+            last_tile_num = tile_num;
+          }
+
+          pixel = tile_pixels[tile_y * 8 + tile_x];
         } else {
-          tile_num = number + block_y * 32;
-        }
+          if (mmio.dispcnt.tile_obj.mapping == DisplayControl::Mapping::OneDimensional) {
+            tile_num = (number << mmio.dispcnt.tile_obj.boundary) + block_y * (width / 8);
+          } else {
+            tile_num = number + block_y * 32;
+          }
 
-        tile_num += block_x;
+          tile_num += block_x;
 
-        pixel = DecodeTilePixel4BPP_OBJ(tile_num * 32, palette, tile_x, tile_y);
-      }
+          if (tile_num != last_tile_num) {
+            tile_pixels = GetDecodedTileOBJ(buffers, tile_num * 32, false, false, palette);
+            last_tile_num = tile_num;
+          }
+
+          pixel = tile_pixels[tile_y * 8 + tile_x];
+        }
 
-      auto& point = buffer_obj[global_x];
-
-      if (pixel != s_color_transparent) {
-        if (mode == OBJ_WINDOW) {
-          point.window = 1;
-        } else if (prio < point.priority) {
-          point.priority = prio;
-          point.color = pixel;
-          point.alpha = (mode == OBJ_SEMI) ? 1 : 0;
-          if (point.alpha) {
-            line_contains_alpha_obj = true;
+        if (pixel != s_color_transparent) {
+          if (mode == OBJ_WINDOW) {
+            buffer_obj.window[global_x] = true;
+          } else if (prio < buffer_obj.priority[global_x]) {
+            buffer_obj.priority[global_x] = prio;
+            buffer_obj.color[global_x] = pixel;
+            buffer_obj.alpha[global_x] = mode == OBJ_SEMI;
+            if (mode == OBJ_SEMI) {
+              buffers.obj_contains_alpha = true;
+            }
           }
         }
       }
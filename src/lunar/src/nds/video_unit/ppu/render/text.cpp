@@ -5,12 +5,14 @@
  * found in the LICENSE file.
  */
 
+#include <cstring>
+
 #include "nds/video_unit/ppu/ppu.hpp"
 
 namespace lunar::nds {
 
-void PPU::RenderLayerText(uint id, u16 vcount) {
-  auto const& mmio = mmio_copy[vcount];
+void PPU::RenderLayerText(uint id, u16 vcount, LineBuffers& buffers) {
+  auto const& mmio = buffers.mmio;
   auto const& bgcnt = mmio.bgcnt[id];
   auto const& mosaic = mmio.mosaic.bg;
 
@@ -36,7 +38,7 @@ void PPU::RenderLayerText(uint id, u16 vcount) {
   u16 tile[8];
   u32 base = mmio.dispcnt.map_block * 65536 + bgcnt.map_block * 2048 + (grid_y % 32) * 64;
 
-  u16* buffer = buffer_bg[id];
+  u16* buffer = buffers.bg[id];
   s32  last_encoder = -1;
   u16  encoder;
   
@@ -70,7 +72,6 @@ void PPU::RenderLayerText(uint id, u16 vcount) {
     do {      
       encoder = atom::read<u16>(render_vram_bg, base + grid_x++ * 2);
 
-      // TODO: speed tile decoding itself up.
       if (encoder != last_encoder) {
         int number  = encoder & 0x3FF;
         int palette = encoder >> 12;
@@ -78,10 +79,18 @@ void PPU::RenderLayerText(uint id, u16 vcount) {
         bool flip_y = encoder & (1 << 11);
         int _tile_y = flip_y ? (tile_y ^ 7) : tile_y;
 
-        if (!bgcnt.full_palette) {
-          DecodeTileLine4BPP(tile, tile_base, palette, number, _tile_y, flip_x);
+        auto pixels = bgcnt.full_palette
+          ? GetDecodedTileBG(buffers, tile_base + number * 64, true, mmio.dispcnt.enable_extpal_bg, palette, expal_slot)
+          : GetDecodedTileBG(buffers, tile_base + number * 32, false, false, palette, 0);
+
+        pixels += _tile_y * 8;
+
+        if (flip_x) {
+          for (int x = 0; x < 8; x++) {
+            tile[x] = pixels[x ^ 7];
+          }
         } else {
-          DecodeTileLine8BPP(tile, tile_base, palette, expal_slot, number, _tile_y, flip_x);
+          std::memcpy(tile, pixels, sizeof(tile));
         }
 
         last_encoder = encoder;
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "nds/video_unit/ppu/ppu.hpp"
+
+namespace lunar::nds {
+
+/* Layout of the decoded tile cache keys:
+ *   bits  0 - 13: tile address / 32
+ *   bits 14 - 19: palette (16-color palette or extended palette slot and palette)
+ *   bit       20: 256 colors
+ *   bit       21: extended palette
+ *   bit       22: OBJ tile
+ */
+enum TileKeyFlags : u32 {
+  TILE_KEY_8BPP   = 1 << 20,
+  TILE_KEY_EXTPAL = 1 << 21,
+  TILE_KEY_OBJ    = 1 << 22
+};
+
+auto PPU::GetDecodedTileBG(LineBuffers& buffers, u32 address, bool is_8bpp, bool enable_extpal, uint palette, uint extpal_slot) -> u16 const* {
+  constexpr u32 mask = sizeof(render_vram_bg) - 1;
+  constexpr int page_shift = Generations::kPageShift;
+
+  address &= mask;
+
+  u32 key = address >> 5;
+  u32 tile_size = is_8bpp ? 64 : 32;
+  u32 tile_generation = generation.vram_bg[address >> page_shift] + generation.vram_bg[((address + tile_size - 1) & mask) >> page_shift];
+  u32 palette_generation;
+
+  if (!is_8bpp) {
+    key |= palette << 14;
+    palette_generation = generation.pram[palette];
+  } else if (enable_extpal) {
+    key |= (extpal_slot * 16 + palette) << 14 | TILE_KEY_8BPP | TILE_KEY_EXTPAL;
+    palette_generation = generation.extpal_bg[extpal_slot * 16 + palette];
+  } else {
+    key |= TILE_KEY_8BPP;
+    palette_generation = generation.pram_bg;
+  }
+
+  auto cached = buffers.tile_cache->Lookup(key, tile_generation, palette_generation);
+
+  if (likely(cached != nullptr)) {
+    return cached;
+  }
+
+  auto pixels = buffers.tile_cache->Insert(key, tile_generation, palette_generation);
+
+  if (!is_8bpp) {
+    auto palette_data = reinterpret_cast<u16 const*>(&render_pram[palette * 32]);
+
+    for (int y = 0; y < 8; y++) {
+      kernels.decode_tile_line_4bpp(&pixels[y * 8], atom::read<u32>(render_vram_bg, (address + y * 4) & mask), palette_data, false);
+    }
+  } else {
+    u16 const* palette_data;
+    u16 color_mask;
+
+    if (enable_extpal) {
+      palette_data = reinterpret_cast<u16 const*>(&render_extpal_bg[0x2000 * extpal_slot + palette * 512]);
+      color_mask = 0xFFFF;
+    } else {
+      palette_data = reinterpret_cast<u16 const*>(&render_pram[0]);
+      color_mask = 0x7FFF;
+    }
+
+    for (int y = 0; y < 8; y++) {
+      kernels.decode_tile_line_8bpp(&pixels[y * 8], atom::read<u64>(render_vram_bg, (address + y * 8) & mask), palette_data, color_mask, false);
+    }
+  }
+
+  return pixels;
+}
+
+auto PPU::GetDecodedTileOBJ(LineBuffers& buffers, u32 address, bool is_8bpp, bool enable_extpal, uint palette) -> u16 const* {
+  constexpr u32 mask = sizeof(render_vram_obj) - 1;
+  constexpr int page_shift = Generations::kPageShift;
+
+  address &= mask;
+
+  u32 key = address >> 5 | TILE_KEY_OBJ;
+  u32 tile_size = is_8bpp ? 64 : 32;
+  u32 tile_generation = generation.vram_obj[address >> page_shift] + generation.vram_obj[((address + tile_size - 1) & mask) >> page_shift];
+  u32 palette_generation;
+
+  // OBJ palettes are numbered 16 - 31, extended OBJ palettes 0 - 15.
+  palette &= 15;
+
+  if (!is_8bpp) {
+    key |= palette << 14;
+    palette_generation = generation.pram[16 + palette];
+  } else if (enable_extpal) {
+    key |= palette << 14 | TILE_KEY_8BPP | TILE_KEY_EXTPAL;
+    palette_generation = generation.extpal_obj[palette];
+  } else {
+    key |= TILE_KEY_8BPP;
+    palette_generation = generation.pram_obj;
+  }
+
+  auto cached = buffers.tile_cache->Lookup(key, tile_generation, palette_generation);
+
+  if (likely(cached != nullptr)) {
+    return cached;
+  }
+
+  auto pixels = buffers.tile_cache->Insert(key, tile_generation, palette_generation);
+
+  if (!is_8bpp) {
+    auto palette_data = reinterpret_cast<u16 const*>(&render_pram[(16 + palette) * 32]);
+
+    for (int y = 0; y < 8; y++) {
+      kernels.decode_tile_line_4bpp(&pixels[y * 8], atom::read<u32>(render_vram_obj, (address + y * 4) & mask), palette_data, false);
+    }
+  } else {
+    u16 const* palette_data;
+    u16 color_mask;
+
+    if (enable_extpal) {
+      palette_data = reinterpret_cast<u16 const*>(&render_extpal_obj[palette * 512]);
+      color_mask = 0xFFFF;
+    } else {
+      palette_data = reinterpret_cast<u16 const*>(&render_pram[0x200]);
+      color_mask = 0x7FFF;
+    }
+
+    for (int y = 0; y < 8; y++) {
+      kernels.decode_tile_line_8bpp(&pixels[y * 8], atom::read<u64>(render_vram_obj, (address + y * 8) & mask), palette_data, color_mask, false);
+    }
+  }
+
+  return pixels;
+}
+
+} // namespace lunar::nds
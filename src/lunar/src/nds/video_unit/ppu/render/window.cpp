@@ -9,33 +9,41 @@
 
 namespace lunar::nds {
 
-void PPU::RenderWindow(uint id, u8 vcount) {
-  auto& mmio = mmio_copy[vcount];
-  auto& winv = mmio.winv[id];
-  auto& winh = mmio.winh[id];
+void PPU::UpdateWindowScanlineEnable(MMIO& mmio, u8 line) {
+  // Only the lower eight bits of VCOUNT are compared with the window boundaries.
+  for (int id = 0; id < 2; id++) {
+    auto& winv = mmio.winv[id];
 
-  if (vcount == winv.min) {
-    window_scanline_enable[id] = true;
-  }
+    if (!mmio.dispcnt.enable[ENABLE_WIN0 + id]) {
+      continue;
+    }
+
+    if (line == winv.min) {
+      mmio.window_scanline_enable[id] = true;
+    }
 
-  if (vcount == winv.max) {
-    window_scanline_enable[id] = false;
+    if (line == winv.max) {
+      mmio.window_scanline_enable[id] = false;
+    }
   }
+}
+
+void PPU::RenderWindow(uint id, u16 vcount, LineBuffers& buffers) {
+  auto const& mmio = buffers.mmio;
+  auto const& winh = mmio.winh[id];
 
-  if (window_scanline_enable[id] && winh._changed) {
+  if (mmio.window_scanline_enable[id]) {
     // TODO: X1=00h is treated as 0 (left-most), X2=00h is treated as 100h (right-most).
     // However, the window is not displayed if X1=X2=00h
     if (winh.min <= winh.max) {
       for (int x = 0; x < 256; x++) {
-        buffer_win[id][x] = x >= winh.min && x < winh.max;
+        buffers.win[id][x] = x >= winh.min && x < winh.max;
       }
     } else {
       for (int x = 0; x < 256; x++) {
-        buffer_win[id][x] = x >= winh.min || x < winh.max;
+        buffers.win[id][x] = x >= winh.min || x < winh.max;
       }
     }
-    
-    winh._changed = false;
   }
 }
 
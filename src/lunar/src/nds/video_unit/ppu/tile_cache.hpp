@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <atom/integer.hpp>
+
+namespace lunar::nds {
+
+/* Direct-mapped cache of decoded 8x8 tiles (15-bit color, 0x8000 is transparent).
+ * An entry is only valid as long as the generation counters of its tile data and palette
+ * are the same as when it was decoded.
+ */
+class TileCache {
+  public:
+    // Returns the decoded pixels of a tile, or nullptr if the tile is not cached or outdated.
+    auto Lookup(u32 key, u32 tile_generation, u32 palette_generation) const -> u16 const* {
+      auto const& entry = entries[Hash(key)];
+
+      if (entry.key == key && entry.tile_generation == tile_generation && entry.palette_generation == palette_generation) {
+        return entry.pixels;
+      }
+      return nullptr;
+    }
+
+    // Replaces the entry for a tile. The caller must decode all 64 pixels into the returned buffer.
+    auto Insert(u32 key, u32 tile_generation, u32 palette_generation) -> u16* {
+      auto& entry = entries[Hash(key)];
+
+      entry.key = key;
+      entry.tile_generation = tile_generation;
+      entry.palette_generation = palette_generation;
+      return entry.pixels;
+    }
+
+  private:
+    static constexpr int kEntryCountLog2 = 10;
+
+    static auto Hash(u32 key) -> u32 {
+      return (key * 0x9E3779B1u) >> (32 - kEntryCountLog2);
+    }
+
+    struct Entry {
+      u32 key = 0xFFFFFFFF;
+      u32 tile_generation = 0;
+      u32 palette_generation = 0;
+      u16 pixels[64];
+    } entries[1 << kEntryCountLog2];
+};
+
+} // namespace lunar::nds
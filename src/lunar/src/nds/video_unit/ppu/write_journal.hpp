@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <atom/integer.hpp>
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <string.h>
+
+namespace lunar::nds {
+
+/* Single-producer single-consumer log of memory writes.
+ * The emulator thread appends each write together with the scanline it happened on,
+ * the render worker applies the write to its copy of the memory before it renders the next scanline.
+ * Apply() may be called from different threads over time, as long as the calls are serialized.
+ */
+template<size_t entry_capacity, size_t data_capacity>
+class WriteJournal {
+  public:
+    WriteJournal() {
+      Reset();
+    }
+
+    // Only safe to call while the consumer is idle.
+    void Reset() {
+      entry_head = 0;
+      entry_tail = 0;
+      data_head = 0;
+      data_tail = 0;
+    }
+
+    /* Reserves space for a write of `size` bytes to `dst` that happened on the scanline `line`.
+     * Returns a pointer to the reserved storage, which must be filled before calling Commit().
+     * Returns nullptr if the journal is full.
+     */
+    auto Push(s64 line, u8* dst, size_t size) -> u8* {
+      size_t head = entry_head.load(std::memory_order_relaxed);
+
+      if (head - entry_tail.load(std::memory_order_acquire) == entry_capacity) {
+        return nullptr;
+      }
+
+      size_t offset = data_head;
+      size_t available = data_capacity - (offset - data_tail.load(std::memory_order_acquire));
+
+      // Allocations never wrap around the end of the ring buffer, skip the remainder instead.
+      size_t wrap_padding = 0;
+
+      if ((offset % data_capacity) + size > data_capacity) {
+        wrap_padding = data_capacity - (offset % data_capacity);
+      }
+
+      if (available < wrap_padding + size) {
+        return nullptr;
+      }
+
+      offset += wrap_padding;
+
+      auto& entry = entries[head % entry_capacity];
+      entry.line = line;
+      entry.dst = dst;
+      entry.size = size;
+      entry.data_end = offset + size;
+
+      data_head = offset + size;
+
+      return &data[offset % data_capacity];
+    }
+
+    // Publishes the write most recently reserved with Push() to the consumer.
+    void Commit() {
+      entry_head.store(entry_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Returns true if writes that happened on or before the scanline `line` have not been applied yet.
+    bool HasPending(s64 line) const {
+      size_t tail = entry_tail.load(std::memory_order_relaxed);
+      size_t head = entry_head.load(std::memory_order_acquire);
+
+      return tail != head && entries[tail % entry_capacity].line <= line;
+    }
+
+    /* Applies all writes that happened on or before the scanline `line`.
+     * on_write(dst, size) is called after each write has been applied.
+     */
+    template<typename Callback>
+    void Apply(s64 line, Callback&& on_write) {
+      size_t tail = entry_tail.load(std::memory_order_relaxed);
+      size_t head = entry_head.load(std::memory_order_acquire);
+
+      if (tail == head || entries[tail % entry_capacity].line > line) {
+        return;
+      }
+
+      size_t data_end;
+
+      do {
+        auto const& entry = entries[tail % entry_capacity];
+
+        if (entry.line > line) {
+          break;
+        }
+
+        data_end = entry.data_end;
+        memcpy(entry.dst, &data[(data_end - entry.size) % data_capacity], entry.size);
+        on_write(entry.dst, entry.size);
+      } while (++tail != head);
+
+      data_tail.store(data_end, std::memory_order_release);
+      entry_tail.store(tail, std::memory_order_release);
+    }
+
+    // Applies all remaining writes regardless of their scanline.
+    template<typename Callback>
+    void Flush(Callback&& on_write) {
+      Apply(std::numeric_limits<s64>::max(), on_write);
+    }
+
+  private:
+    struct Entry {
+      s64 line;
+      u8* dst;
+      size_t size;
+      size_t data_end;
+    } entries[entry_capacity];
+
+    u8 data[data_capacity];
+
+    // Producer-owned write positions
+    std::atomic<size_t> entry_head;
+    size_t data_head;
+
+    // Consumer-owned read positions
+    std::atomic<size_t> entry_tail;
+    std::atomic<size_t> data_tail;
+};
+
+} // namespace lunar::nds
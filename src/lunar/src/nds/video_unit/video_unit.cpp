@@ -44,6 +44,9 @@ void VideoUnit::Reset() {
   dispcapcnt = {};
   capturing = false;
   display_swap = false;
+  pending_frame = {};
+  skipping_frame = false;
+  skipped_3d_frame = false;
 
   dispstat7.write_cb = [this]() {
     CheckVerticalCounterIRQ(dispstat7, irq7);
@@ -53,14 +56,101 @@ void VideoUnit::Reset() {
     CheckVerticalCounterIRQ(dispstat9, irq9);
   };
 
+  powcnt1.write_cb = [this]() {
+    ppu_a.SetPowered(powcnt1.enable_ppu_a);
+    ppu_b.SetPowered(powcnt1.enable_ppu_b);
+  };
+
   ppu_a.Reset();
   ppu_b.Reset();
+  powcnt1.write_cb();
 
   OnHdrawBegin(0);
 }
 
 void VideoUnit::SetVideoDevice(VideoDevice& device) {
   video_device = &device;
+
+  // The current frame has been started with the previous output buffers and format, so it is not presented.
+  video_device_ready = false;
+  pending_frame.valid = false;
+}
+
+void VideoUnit::AcquireOutputBuffers() {
+  if (video_device == nullptr) {
+    return;
+  }
+
+  auto format = video_device->GetPixelFormat();
+  auto& ppu_top = display_swap ? ppu_a : ppu_b;
+  auto& ppu_bottom = display_swap ? ppu_b : ppu_a;
+
+  ppu_top.SetOutputBuffer(format, video_device->AcquireFrameBuffer(VideoDevice::Screen::Top));
+  ppu_bottom.SetOutputBuffer(format, video_device->AcquireFrameBuffer(VideoDevice::Screen::Bottom));
+  video_device_ready = true;
+}
+
+void VideoUnit::QueueFrame() {
+  auto& ppu_top = display_swap ? ppu_a : ppu_b;
+  auto& ppu_bottom = display_swap ? ppu_b : ppu_a;
+
+  // PPU A may not have rendered the frame during VBlank, in that case its 2D layers have not been merged with the OpenGL 3D frame yet.
+  ppu_a.MergeOpenGLFrame(true);
+
+  pending_frame.valid = true;
+  pending_frame.frame_a = ppu_a.GetFrame();
+  pending_frame.frame_b = ppu_b.GetFrame();
+  pending_frame.top_image_type = ppu_top.GetOutputImageType();
+  pending_frame.top_image = ppu_top.GetOutput();
+  pending_frame.bottom_image_type = ppu_bottom.GetOutputImageType();
+  pending_frame.bottom_image = ppu_bottom.GetOutput();
+}
+
+void VideoUnit::PresentFrame(bool wait) {
+  if (!pending_frame.valid) {
+    return;
+  }
+
+  if (wait) {
+    ppu_a.WaitForFrame(pending_frame.frame_a);
+    ppu_b.WaitForFrame(pending_frame.frame_b);
+  } else if (!ppu_a.IsFrameRendered(pending_frame.frame_a) || !ppu_b.IsFrameRendered(pending_frame.frame_b)) {
+    return;
+  }
+
+  video_device->Draw(
+    pending_frame.top_image_type, pending_frame.top_image,
+    pending_frame.bottom_image_type, pending_frame.bottom_image
+  );
+  pending_frame.valid = false;
+}
+
+void VideoUnit::Render3D() {
+  // PPU A may read from the GPUs framebuffer. The software renderer renders the next frame to a separate buffer,
+  // but with the OpenGL renderer PPU A has to finish work and merge its frame before we start rendering the next GPU frame.
+  if (gpu.GetOutputImageType() == VideoDevice::ImageType::OpenGL) {
+    ppu_a.WaitForRenderWorker();
+    ppu_a.MergeOpenGLFrame(true);
+  }
+
+  gpu.Render();
+  skipped_3d_frame = false;
+}
+
+auto VideoUnit::Is3DFrameUsed() -> bool {
+  auto const& dispcnt = ppu_a.mmio.dispcnt;
+
+  if (!powcnt1.enable_gpu_render) {
+    return false;
+  }
+
+  // Display capture may read the 3D frame regardless of whether BG0 is enabled.
+  if (dispcapcnt.busy) {
+    return true;
+  }
+
+  return powcnt1.enable_ppu_a && dispcnt.display_mode == 1 &&
+         dispcnt.enable[0] && (dispcnt.enable_bg0_3d || dispcnt.bg_mode == 6);
 }
 
 void VideoUnit::CheckVerticalCounterIRQ(DisplayStatus& dispstat, IRQ& irq) {
@@ -75,24 +165,38 @@ void VideoUnit::CheckVerticalCounterIRQ(DisplayStatus& dispstat, IRQ& irq) {
 
 void VideoUnit::OnHdrawBegin(int late) {
   if (++vcount.value == kTotalLines) {
-    ppu_b.WaitForRenderWorker();
+    /* The PPUs keep rendering the frame while the next one is emulated, it is presented as soon as it has been rendered.
+     * The previous frame must be presented before its output buffers are reused.
+     */
+    PresentFrame(true);
 
-    if (video_device != nullptr) {
-      if(display_swap) {
-        video_device->Draw(ppu_a.GetOutputImageType(), ppu_a.GetOutput(), ppu_b.GetOutputImageType(), ppu_b.GetOutput());
-      } else {
-        video_device->Draw(ppu_b.GetOutputImageType(), ppu_b.GetOutput(), ppu_a.GetOutputImageType(), ppu_a.GetOutput());
-      }
+    if (video_device != nullptr && video_device_ready) {
+      QueueFrame();
     }
-    ppu_a.SwapBuffers();
-    ppu_b.SwapBuffers();
 
     display_swap = powcnt1.display_swap;
     vcount.value = 0;
     capturing = dispcapcnt.busy;
+
+    // Display capture writes to VRAM, so frames that use it are always rendered.
+    skipping_frame = skip_rendering && !capturing;
+    ppu_a.SetSkipRendering(skipping_frame);
+    ppu_b.SetSkipRendering(skipping_frame);
+
+    if (skipping_frame) {
+      video_device_ready = false;
+    } else {
+      AcquireOutputBuffers();
+
+      if (skipped_3d_frame && Is3DFrameUsed()) {
+        Render3D();
+      }
+    }
     gpu.Sync();
   }
 
+  PresentFrame(false);
+
   CheckVerticalCounterIRQ(dispstat7, irq7);
   CheckVerticalCounterIRQ(dispstat9, irq9);
 
@@ -113,16 +217,25 @@ void VideoUnit::OnHdrawBegin(int late) {
 
     gpu.SwapBuffers();
 
+    // The capture is complete once VBlank begins.
+    if (capturing) {
+      ppu_a.WriteBackDisplayCapture(vram.region_lcdc, true);
+    }
+
     dispcapcnt.busy = false;
     capturing = false;
   }
 
   if (vcount.value == kTotalLines - 48) {
-    // PPU A may read from the GPUs framebuffer,
-    // so make sure that it finishes work before we start rendering the next GPU frame.
-    ppu_a.WaitForRenderWorker();
-
-    gpu.Render();
+    /* The 3D frame is displayed during the next frame, so it is not rendered if that frame is going to be skipped
+     * or if neither BG0 nor display capture are going to read it. If it turns out to be read when the next frame begins,
+     * it is rendered then. Enabling the 3D layer later during that frame still shows the last 3D frame that was rendered.
+     */
+    skipped_3d_frame = (skip_rendering && !dispcapcnt.busy) || !Is3DFrameUsed();
+
+    if (!skipped_3d_frame) {
+      Render3D();
+    }
   }
 
   if (vcount.value == kTotalLines - 1) {
@@ -135,8 +248,8 @@ void VideoUnit::OnHdrawBegin(int late) {
 
   if (vcount.value <= kDrawingLines - 1) {
     // TODO: check if display capture actually reads BG+3D
-    ppu_a.OnDrawScanlineBegin(vcount.value, dispcapcnt.busy);
-    ppu_b.OnDrawScanlineBegin(vcount.value, false);
+    ppu_a.OnDrawScanlineBegin(vcount.value, dispcapcnt.busy, GetDisplayCapture());
+    ppu_b.OnDrawScanlineBegin(vcount.value, false, {});
   } else {
     ppu_a.OnBlankScanlineBegin(vcount.value);
     ppu_b.OnBlankScanlineBegin(vcount.value);
@@ -162,116 +275,55 @@ void VideoUnit::OnHblankBegin(int late) {
     ppu_a.OnDrawScanlineEnd();
     ppu_b.OnDrawScanlineEnd();
     if (capturing) {
-      RunDisplayCapture();
+      ppu_a.WriteBackDisplayCapture(vram.region_lcdc, false);
     }
   }
 
   scheduler.Add(524 - late, this, &VideoUnit::OnHdrawBegin);
 }
 
-void VideoUnit::RunDisplayCapture() {
+auto VideoUnit::GetDisplayCapture() -> PPU::DisplayCapture {
   constexpr int kCaptureWidthLUT[4]{ 128, 256, 256, 256 };
   constexpr int kCaptureHeightLUT[4]{ 128, 64, 128, 192 };
 
-  auto height = kCaptureHeightLUT[dispcapcnt.capture_size];
-
-  if (vcount.value < height) {
-    auto width = kCaptureWidthLUT[dispcapcnt.capture_size];
-    auto capture_source = dispcapcnt.capture_source;
-    auto line_offset = vcount.value * 256;
+  PPU::DisplayCapture capture;
 
-    auto vram_write_base = dispcapcnt.vram_write_block << 17;
-    auto vram_write_offset = dispcapcnt.vram_write_offset << 15;
-    auto vram_write_address = vram_write_base + ((vram_write_offset + line_offset * sizeof(u16)) & 0x1FFFF);
-    auto buffer_dst = vram.region_lcdc.GetUnsafePointer<u16>(vram_write_address);
+  if (!capturing || vcount.value >= kCaptureHeightLUT[dispcapcnt.capture_size]) {
+    return capture;
+  }
 
-    if (unlikely(buffer_dst == nullptr)) {
-      return;
-    }
+  auto line_offset = vcount.value * 256;
 
-    ppu_a.WaitForRenderWorker();
+  auto vram_write_base = dispcapcnt.vram_write_block << 17;
+  auto vram_write_offset = dispcapcnt.vram_write_offset << 15;
+  auto vram_write_address = vram_write_base + ((vram_write_offset + line_offset * sizeof(u16)) & 0x1FFFF);
 
-    auto capture_a = [&](u16* dst) {
-      if (dispcapcnt.source_a == CaptureControl::SourceA::GPUAndPPU) {
-        std::memcpy(dst, ppu_a.GetComposerOutput(), sizeof(u16) * width);
-      } else {
-        gpu.CaptureColor(dst, vcount.value, width, true);
-      }
-    };
-
-    auto capture_b = [&](u16* dst) {
-      if (dispcapcnt.source_b == CaptureControl::SourceB::VRAM) {
-        auto vram_read_base = ppu_a.mmio.dispcnt.vram_block << 17;
-        auto vram_read_offset = dispcapcnt.vram_read_offset << 15;
-        auto src = vram.region_lcdc.GetUnsafePointer<u16>(
-          vram_read_base + ((vram_read_offset + line_offset * sizeof(u16)) & 0x1FFFF));
-
-        if (likely(src != nullptr)) {
-          std::memcpy(dst, src, sizeof(u16) * width);
-        } else {
-          std::memset(dst, 0, sizeof(u16) * width);
-        }
-      } else {
-        ATOM_PANIC("VideoUnit: unhandled main memory display FIFO capture");
-      }
-    };
+  if (unlikely(vram.region_lcdc.GetUnsafePointer<u16>(vram_write_address) == nullptr)) {
+    return capture;
+  }
 
-    switch (capture_source) {
-      case CaptureControl::CaptureSource::A: {
-        capture_a(buffer_dst);
-        break;
-      }
-      case CaptureControl::CaptureSource::B: {
-        capture_b(buffer_dst);
-        break;
-      }
-      default: {
-        u16 buffer_a[width];
-        u16 buffer_b[width];
-
-        capture_a(buffer_a);
-        capture_b(buffer_b);
-
-        auto eva = std::min(dispcapcnt.eva, 16);
-        auto evb = std::min(dispcapcnt.evb, 16);
-        bool need_clamp = (eva + evb) > 16;
-
-        for (int x = 0; x < width; x++) {
-          auto color_a = buffer_a[x];
-          auto color_b = buffer_b[x];
-
-          auto r_a = (color_a >>  0) & 31;
-          auto g_a = (color_a >>  5) & 31;
-          auto b_a = (color_a >> 10) & 31;
-          auto a_a =  color_a >> 15;
-
-          auto r_b = (color_b >>  0) & 31;
-          auto g_b = (color_b >>  5) & 31;
-          auto b_b = (color_b >> 10) & 31;
-          auto a_b =  color_b >> 15;
-
-          auto factor_a = a_a * eva;
-          auto factor_b = a_b * evb;
-
-          auto r_out = (r_a * factor_a + r_b * factor_b + 8) >> 4;
-          auto g_out = (g_a * factor_a + g_b * factor_b + 8) >> 4;
-          auto b_out = (b_a * factor_a + b_b * factor_b + 8) >> 4;
-          auto a_out = (eva > 0 ? a_a : 0) | (evb > 0 ? a_b : 0);
-
-          if (need_clamp) {
-            r_out = std::min(r_out, 15);
-            g_out = std::min(g_out, 15);
-            b_out = std::min(b_out, 15);
-          }
-
-          buffer_dst[x] = r_out | (g_out << 5) | (b_out << 10) | (a_out << 15);
-        }
-        break;
-      }
-    }
+  auto vram_read_base = ppu_a.mmio.dispcnt.vram_block << 17;
+  auto vram_read_offset = dispcapcnt.vram_read_offset << 15;
+
+  capture.enable = true;
+  capture.source_a_3d = dispcapcnt.source_a == CaptureControl::SourceA::GPU;
+  capture.eva = dispcapcnt.eva;
+  capture.evb = dispcapcnt.evb;
+  capture.width = kCaptureWidthLUT[dispcapcnt.capture_size];
+  capture.read_address = vram_read_base + ((vram_read_offset + line_offset * sizeof(u16)) & 0x1FFFF);
+  capture.write_address = vram_write_address;
+
+  switch (dispcapcnt.capture_source) {
+    case CaptureControl::CaptureSource::A: capture.source = PPU::DisplayCapture::Source::A; break;
+    case CaptureControl::CaptureSource::B: capture.source = PPU::DisplayCapture::Source::B; break;
+    default: capture.source = PPU::DisplayCapture::Source::Blend; break;
+  }
 
-    ppu_a.OnWriteVRAM_LCDC(vram_write_address, vram_write_address + width * sizeof(u16));
+  if (capture.source != PPU::DisplayCapture::Source::A && dispcapcnt.source_b == CaptureControl::SourceB::FIFO) {
+    ATOM_PANIC("VideoUnit: unhandled main memory display FIFO capture");
   }
+
+  return capture;
 }
 
 auto VideoUnit::DisplayStatus::ReadByte(uint offset) -> u8 {
@@ -325,10 +377,10 @@ auto VideoUnit::PowerControl::ReadByte(uint offset) -> u8 {
     case 0:
       return (enable_lcds  ? 1 : 0) |
              (enable_ppu_a ? 2 : 0) |
-             (enable_ppu_b ? 4 : 0) |
+             (enable_gpu_render ? 4 : 0) |
              (enable_gpu_geometry ? 8 : 0);
     case 1:
-      return (enable_gpu_render ? 2 : 0) |
+      return (enable_ppu_b ? 2 : 0) |
              (display_swap ? 128 : 0);
   }
 
@@ -340,16 +392,18 @@ void VideoUnit::PowerControl::WriteByte(uint offset, u8 value) {
     case 0:
       enable_lcds = value & 1;
       enable_ppu_a = value & 2;
-      enable_ppu_b = value & 4;
+      enable_gpu_render = value & 4;
       enable_gpu_geometry = value & 8;
       break;
     case 1:
-      enable_gpu_render = value & 2;
+      enable_ppu_b = value & 2;
       display_swap = value & 128;
       break;
     default:
       ATOM_UNREACHABLE();
   }
+
+  write_cb();
 }
 
 auto VideoUnit::CaptureControl::ReadByte(uint offset) -> u8 {
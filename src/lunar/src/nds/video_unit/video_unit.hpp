@@ -32,6 +32,18 @@ class VideoUnit {
     void Reset();
     void SetVideoDevice(VideoDevice& device);
 
+    void SetRenderMemoization(bool enable) {
+      ppu_a.SetMemoization(enable);
+      ppu_b.SetMemoization(enable);
+    }
+
+    /* Skips 2D and 3D rendering of the frames that begin while enabled, they are not presented either.
+     * Frames that use display capture are rendered regardless. Emulated state is not affected.
+     */
+    void SetSkipRendering(bool skip) {
+      skip_rendering = skip;
+    }
+
     // Graphics status and IRQ control.
     struct DisplayStatus {
       auto ReadByte (uint offset) -> u8;
@@ -61,7 +73,7 @@ class VideoUnit {
     } vcount;
 
     // Graphics power control register
-    // TODO: right now all bits except for "display_swap" will be ignored.
+    // TODO: the LCDs and the geometry engine are always powered on.
     struct PowerControl {
       auto ReadByte (uint offset) -> u8;
       void WriteByte(uint offset, u8 value);
@@ -75,6 +87,8 @@ class VideoUnit {
       bool enable_gpu_geometry = false;
       bool enable_gpu_render = false;
       bool display_swap = false;
+
+      std::function<void(void)> write_cb;
     } powcnt1;
 
     struct CaptureControl {
@@ -123,7 +137,12 @@ class VideoUnit {
     void CheckVerticalCounterIRQ(DisplayStatus& dispstat, IRQ& irq);
     void OnHdrawBegin(int late);
     void OnHblankBegin(int late);
-    void RunDisplayCapture();
+    auto GetDisplayCapture() -> PPU::DisplayCapture;
+    void AcquireOutputBuffers();
+    void QueueFrame();
+    void PresentFrame(bool wait);
+    void Render3D();
+    auto Is3DFrameUsed() -> bool;
 
     Scheduler& scheduler;
     IRQ& irq7;
@@ -131,6 +150,21 @@ class VideoUnit {
     DMA7& dma7;
     DMA9& dma9;
     VideoDevice* video_device = nullptr;
+    bool video_device_ready = false; //< Current frame is rendered to the video device's buffers and format
+    bool skip_rendering = false; //< Skip rendering of the frames that begin from now on
+    bool skipping_frame; //< Current frame is not rendered
+    bool skipped_3d_frame; //< The 3D frame that is displayed next has not been rendered
+
+    // Frame that has been emulated, but not passed to the video device yet because the PPUs are still rendering it.
+    struct PendingFrame {
+      bool valid = false;
+      s64 frame_a;
+      s64 frame_b;
+      VideoDevice::ImageType top_image_type;
+      void const* top_image;
+      VideoDevice::ImageType bottom_image_type;
+      void const* bottom_image;
+    } pending_frame;
 };
 
 } // namespace lunar::nds
@@ -11,6 +11,7 @@
 #include <atom/meta.hpp>
 #include <algorithm>
 #include <array>
+#include <cstring>
 #include <functional>
 #include <stddef.h>
 #include <vector>
@@ -66,6 +67,39 @@ class Region {
       }
     }
 
+    // Size of the address range after which the mapped pages repeat.
+    auto GetMirrorSize() const -> size_t {
+      return (mask + 1) << kPageShift;
+    }
+
+    // Reads size bytes starting at offset, copying whole spans of each page at once.
+    void ReadBlock(u32 offset, u8* dst, size_t size) const {
+      while (size > 0) {
+        auto const& desc = pages[(offset >> kPageShift) & mask];
+        auto page_offset = offset & kPageMask;
+        auto chunk = std::min<size_t>(size, page_size - page_offset);
+
+        if (likely(desc.page != nullptr)) {
+          std::memcpy(dst, &desc.page[page_offset], chunk);
+        } else {
+          std::fill_n(dst, chunk, 0);
+
+          // Multiple banks are mapped to this page, so the data read is the bitwise OR of all of them.
+          if (unlikely(desc.pages != nullptr)) {
+            for (u8* page : *desc.pages) {
+              for (size_t i = 0; i < chunk; i++) {
+                dst[i] |= page[page_offset + i];
+              }
+            }
+          }
+        }
+
+        offset += chunk;
+        dst += chunk;
+        size -= chunk;
+      }
+    }
+
     template<typename T>
     auto GetUnsafePointer(u32 offset) const -> T const* {
       auto const& desc = pages[(offset >> kPageShift) & mask];
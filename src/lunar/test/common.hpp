@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <atom/integer.hpp>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common/simd.hpp"
+#include "nds/video_unit/gpu/kernels/kernels.hpp"
+#include "nds/video_unit/ppu/kernels/kernels.hpp"
+
+// Shared helpers of the kernel tests and benchmarks.
+
+namespace lunar::test {
+
+// Deterministic random numbers, so that a failing test fails the same way on every run.
+struct Random {
+  Random(u32 seed) : engine(seed) {}
+
+  auto operator()() -> u32 {
+    return engine();
+  }
+
+  auto Next64() -> u64 {
+    return ((u64)engine() << 32) | engine();
+  }
+
+  // Returns true once in every n calls on average.
+  auto OneIn(u32 n) -> bool {
+    return engine() % n == 0;
+  }
+
+  template<typename T, typename Generator>
+  void Fill(T* data, size_t size, Generator const& generator) {
+    for (size_t i = 0; i < size; i++) {
+      data[i] = generator();
+    }
+  }
+
+  std::mt19937 engine;
+};
+
+template<typename Kernels>
+struct KernelSet {
+  char const* name;
+  Kernels const* kernels;
+};
+
+// Returns the PPU kernels that the host CPU supports, starting with the scalar kernels.
+inline auto GetPPUKernelSets() -> std::vector<KernelSet<nds::PPUKernels>> {
+  std::vector<KernelSet<nds::PPUKernels>> sets{{"scalar", &nds::g_ppu_kernels_scalar}};
+
+#if defined(LUNAR_SIMD_X86)
+  auto level = GetHostSIMDLevel();
+
+  if (level >= SIMDLevel::SSE41) sets.push_back({"sse41", &nds::g_ppu_kernels_sse41});
+  if (level >= SIMDLevel::AVX2)  sets.push_back({"avx2",  &nds::g_ppu_kernels_avx2});
+#endif
+
+  return sets;
+}
+
+// Returns the GPU kernels that the host CPU supports, starting with the scalar kernels.
+inline auto GetGPUKernelSets() -> std::vector<KernelSet<nds::GPUKernels>> {
+  std::vector<KernelSet<nds::GPUKernels>> sets{{"scalar", &nds::g_gpu_kernels_scalar}};
+
+#if defined(LUNAR_SIMD_X86)
+  auto level = GetHostSIMDLevel();
+
+  if (level >= SIMDLevel::SSE41) sets.push_back({"sse41", &nds::g_gpu_kernels_sse41});
+  if (level >= SIMDLevel::AVX2)  sets.push_back({"avx2",  &nds::g_gpu_kernels_avx2});
+#endif
+
+  return sets;
+}
+
+/* Compares count values and reports the first mismatch.
+ * Returns false on a mismatch, so that a test can stop at the first failure.
+ */
+template<typename T>
+auto ExpectEqual(char const* what, T const* expected, T const* actual, int count) -> bool {
+  for (int i = 0; i < count; i++) {
+    if (expected[i] != actual[i]) {
+      std::printf("FAIL %s: mismatch at %d, expected 0x%llX, got 0x%llX\n",
+        what, i, (unsigned long long)expected[i], (unsigned long long)actual[i]);
+      return false;
+    }
+  }
+  return true;
+}
+
+// Runs functor iterations times and prints the average time per item, where each run processes items items.
+template<typename Functor>
+void Measure(std::string const& name, int iterations, int items, Functor&& functor) {
+  auto t0 = std::chrono::steady_clock::now();
+
+  for (int i = 0; i < iterations; i++) {
+    functor();
+  }
+
+  auto t1 = std::chrono::steady_clock::now();
+  auto ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / ((double)iterations * items);
+
+  std::printf("%-40s %10.2f ns\n", name.c_str(), ns);
+}
+
+} // namespace lunar::test
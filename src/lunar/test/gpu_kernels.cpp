@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <string.h>
+#include <string>
+
+#include "common.hpp"
+#include "nds/video_unit/gpu/fixed_point.hpp"
+#include "nds/video_unit/gpu/matrix.hpp"
+
+using namespace lunar;
+using namespace lunar::nds;
+
+/* Checks that all geometry kernels return exactly the same results as the generic Matrix4 and Vector code,
+ * including products that overflow 32 bits and results that are written to one of the operands.
+ */
+
+static auto ToMatrix(s32 const* data) -> Matrix4<Fixed20x12> {
+  Matrix4<Fixed20x12> matrix;
+
+  for (int col = 0; col < 4; col++) {
+    for (int row = 0; row < 4; row++) {
+      matrix[col][row] = data[col * 4 + row];
+    }
+  }
+  return matrix;
+}
+
+template<typename Vector>
+static void FromVector(s32* data, Vector const& vector, int size) {
+  for (int i = 0; i < size; i++) {
+    data[i] = vector[i].raw();
+  }
+}
+
+int main() {
+  auto rng = test::Random{0x10AB};
+  auto kernel_sets = test::GetGPUKernelSets();
+
+  // Mixes small 20.12 values, large values whose products overflow and the most negative value.
+  auto value = [&]() -> s32 {
+    switch (rng() % 4) {
+      case 0:  return (s32)(rng() % 0x2000) - 0x1000;
+      case 1:  return (s32)(rng() % 0x200000) - 0x100000;
+      case 2:  return (s32)0x80000000;
+      default: return (s32)rng();
+    }
+  };
+
+  for (int i = 0; i < 100000; i++) {
+    s32 lhs[16];
+    s32 rhs[16];
+    s32 vec[4];
+    s32 normal[3];
+    LightVectors light_vectors;
+
+    rng.Fill(lhs, 16, value);
+    rng.Fill(rhs, 16, value);
+    rng.Fill(vec, 4, value);
+    rng.Fill(normal, 3, value);
+    rng.Fill(light_vectors.x, 8, value);
+    rng.Fill(light_vectors.y, 8, value);
+    rng.Fill(light_vectors.z, 8, value);
+
+    // Reference results, computed the way the geometry engine did before it used the kernels.
+    s32 mat4_mat4[16];
+    s32 mat4_vec4[4];
+    s32 dots[8];
+
+    auto product = ToMatrix(lhs) * ToMatrix(rhs);
+    auto normal_vec3 = Vector3<Fixed20x12>{normal[0], normal[1], normal[2]};
+
+    for (int col = 0; col < 4; col++) {
+      FromVector(&mat4_mat4[col * 4], product[col], 4);
+    }
+    FromVector(mat4_vec4, ToMatrix(lhs) * Vector4<Fixed20x12>{vec[0], vec[1], vec[2], vec[3]}, 4);
+
+    for (int j = 0; j < 8; j++) {
+      auto light_vector = Vector3<Fixed20x12>{light_vectors.x[j], light_vectors.y[j], light_vectors.z[j]};
+
+      dots[j] = light_vector.Dot(normal_vec3).raw();
+    }
+
+    for (auto [name, kernels] : kernel_sets) {
+      auto what = [&](char const* kernel) { return std::string{name} + " " + kernel; };
+
+      s32 actual[16];
+
+      kernels->multiply_mat4_mat4(actual, lhs, rhs);
+
+      if (!test::ExpectEqual(what("multiply_mat4_mat4").c_str(), mat4_mat4, actual, 16)) return 1;
+
+      kernels->multiply_mat4_vec4(actual, lhs, vec);
+
+      if (!test::ExpectEqual(what("multiply_mat4_vec4").c_str(), mat4_vec4, actual, 4)) return 1;
+
+      kernels->dot_light_vectors(actual, light_vectors, normal);
+
+      if (!test::ExpectEqual(what("dot_light_vectors").c_str(), dots, actual, 8)) return 1;
+
+      // The result may be written to one of the operands.
+      memcpy(actual, lhs, sizeof(lhs));
+      kernels->multiply_mat4_mat4(actual, actual, rhs);
+
+      if (!test::ExpectEqual(what("multiply_mat4_mat4 (result is lhs)").c_str(), mat4_mat4, actual, 16)) return 1;
+
+      memcpy(actual, rhs, sizeof(rhs));
+      kernels->multiply_mat4_mat4(actual, lhs, actual);
+
+      if (!test::ExpectEqual(what("multiply_mat4_mat4 (result is rhs)").c_str(), mat4_mat4, actual, 16)) return 1;
+
+      memcpy(actual, vec, sizeof(vec));
+      kernels->multiply_mat4_vec4(actual, lhs, actual);
+
+      if (!test::ExpectEqual(what("multiply_mat4_vec4 (result is vec)").c_str(), mat4_vec4, actual, 4)) return 1;
+    }
+  }
+
+  return 0;
+}
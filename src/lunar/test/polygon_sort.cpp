@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "nds/video_unit/gpu/polygon_sort.hpp"
+#include "polygon_sort.hpp"
+
+using namespace lunar;
+using namespace lunar::nds;
+using test::TestPolygon;
+
+/* Checks that SortPolygonsByKey() orders polygons exactly like std::stable_sort() does,
+ * for automatic and manual Y-sorting of translucent polygons and polygon counts up to the 2048 polygon limit.
+ */
+
+int main() {
+  static std::array<TestPolygon, 2048> polygons;
+  static std::array<TestPolygon*, 2048> scratch;
+
+  auto rng = test::Random{0x5027};
+
+  for (bool manual_translucent_y_sorting : {false, true}) {
+    for (int i = 0; i < 2000; i++) {
+      int count = i * 2048 / 1999;
+
+      rng.Fill(polygons.data(), count, [&]() { return TestPolygon{test::RandomSortingKey(rng, manual_translucent_y_sorting)}; });
+
+      std::vector<TestPolygon*> expected;
+      std::vector<TestPolygon*> actual;
+
+      for (int j = 0; j < count; j++) {
+        expected.push_back(&polygons[j]);
+        actual.push_back(&polygons[j]);
+      }
+
+      std::stable_sort(expected.begin(), expected.end(), test::CompareSortingKeys);
+      SortPolygonsByKey(actual.data(), scratch.data(), count);
+
+      if (!test::ExpectEqual(manual_translucent_y_sorting ? "manual Y-sorting" : "auto Y-sorting", expected.data(), actual.data(), count)) {
+        return 1;
+      }
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <algorithm>
+
+#include "common.hpp"
+
+namespace lunar::test {
+
+// Polygon that only holds what SortPolygonsByKey() looks at.
+struct TestPolygon {
+  u32 sorting_key;
+};
+
+/* Returns a sorting key with the layout that GPU::SubmitVertex() assigns to polygons:
+ * translucent polygons in bit 31, followed by the max Y and min Y coordinates (14 bits each),
+ * unless the polygon is translucent and translucent polygons are sorted manually (in submission order).
+ */
+inline auto RandomSortingKey(Random& rng, bool manual_translucent_y_sorting) -> u32 {
+  bool translucent = rng.OneIn(4);
+
+  u32 key = translucent ? 0x8000'0000 : 0;
+
+  if (!translucent || !manual_translucent_y_sorting) {
+    u32 min_y = rng() % 0x4000;
+    u32 max_y = rng() % 0x4000;
+
+    // Most polygons are on screen and small, which is a narrow range of Y coordinates.
+    if (!rng.OneIn(4)) {
+      min_y = 0x1000 + rng() % 0x2000;
+      max_y = std::min<u32>(min_y + rng() % 0x100, 0x3FFF);
+    }
+
+    key |= min_y | (max_y << 14);
+  }
+
+  return key;
+}
+
+inline auto CompareSortingKeys(TestPolygon const* a, TestPolygon const* b) -> bool {
+  return a->sorting_key < b->sorting_key;
+}
+
+} // namespace lunar::test
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <algorithm>
+#include <array>
+#include <string>
+
+#include "nds/video_unit/gpu/polygon_sort.hpp"
+#include "polygon_sort.hpp"
+
+using namespace lunar;
+using namespace lunar::nds;
+using test::TestPolygon;
+
+// Measures the time per sorted polygon of SortPolygonsByKey() and of std::stable_sort() for typical polygon counts.
+
+int main() {
+  static std::array<TestPolygon, 2048> polygons;
+  static std::array<TestPolygon*, 2048> sorted;
+  static std::array<TestPolygon*, 2048> scratch;
+
+  auto rng = test::Random{0x5027};
+
+  for (bool manual_translucent_y_sorting : {false, true}) {
+    for (int count : {128, 256, 512, 768, 1024, 2048}) {
+      rng.Fill(polygons.data(), count, [&]() { return TestPolygon{test::RandomSortingKey(rng, manual_translucent_y_sorting)}; });
+
+      // Each run sorts the polygons from submission order.
+      auto reset = [&]() {
+        for (int i = 0; i < count; i++) sorted[i] = &polygons[i];
+      };
+
+      auto name = std::string{manual_translucent_y_sorting ? "manual " : "auto "} + std::to_string(count);
+
+      test::Measure(name + " SortPolygonsByKey", 2000, count, [&]() {
+        reset();
+        SortPolygonsByKey(sorted.data(), scratch.data(), count);
+      });
+
+      test::Measure(name + " std::stable_sort", 2000, count, [&]() {
+        reset();
+        std::stable_sort(sorted.begin(), sorted.begin() + count, test::CompareSortingKeys);
+      });
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <memory>
+#include <string>
+
+#include "ppu_composer.hpp"
+
+using namespace lunar;
+using namespace lunar::nds;
+
+/* Checks that the compositor kernels return exactly the same pixels as the generic compositor,
+ * for each color special effect, with and without windows and with the 3D BG0 layer.
+ */
+
+int main() {
+  static char const* const sfx_names[] { "none", "blend", "brighten", "darken" };
+
+  auto rng = test::Random{0xC0FF};
+
+  for (auto [name, kernels] : test::GetPPUKernelSets()) {
+    // The scalar kernels have no compositor, the PPU uses its generic compositor instead.
+    if (kernels->compose_scanline == nullptr) {
+      continue;
+    }
+
+    for (int sfx = 0; sfx < 4; sfx++) {
+      for (int i = 0; i < 5000; i++) {
+        bool window = i % 4 >= 2;
+        bool bg0_3d = i % 2;
+
+        auto scanline = std::make_unique<test::RandomScanline>(rng, (ComposerInput::Effect)sfx, window, bg0_3d);
+
+        u16 expected[256];
+        u16 actual[256];
+
+        test::ComposeScanlineReference(expected, scanline->input);
+        kernels->compose_scanline(actual, scanline->input);
+
+        auto what = std::string{name} + " sfx=" + sfx_names[sfx] + " window=" + std::to_string(window) + " bg0_3d=" + std::to_string(bg0_3d);
+
+        if (!test::ExpectEqual(what.c_str(), expected, actual, 256)) {
+          return 1;
+        }
+      }
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <algorithm>
+
+#include "common.hpp"
+
+namespace lunar::test {
+
+using nds::ComposerInput;
+
+/* Generic compositor on a ComposerInput, which follows PPU::ComposeScanlineTmpl() (without OpenGL compositing)
+ * pixel for pixel, and serves as the reference for the compose_scanline kernels.
+ */
+template<bool window, bool blending>
+void ComposeScanlineReference(u16* output, ComposerInput const& input) {
+  static constexpr u16 kColorTransparent = 0x8000;
+  static constexpr int kLayerOBJ = 4;
+  static constexpr int kLayerBD = 5;
+
+  auto blend = [](u16 target1, u16 target2, int eva, int evb) -> u16 {
+    eva = std::min(eva, 16);
+    evb = std::min(evb, 16);
+
+    int r = std::min(((target1 >>  0 & 31) * eva + (target2 >>  0 & 31) * evb) >> 4, 31);
+    int g = std::min(((target1 >>  5 & 31) * eva + (target2 >>  5 & 31) * evb) >> 4, 31);
+    int b = std::min(((target1 >> 10 & 31) * eva + (target2 >> 10 & 31) * evb) >> 4, 31);
+
+    return r | g << 5 | b << 10;
+  };
+
+  auto brighten = [](u16 target, int evy, bool darken) -> u16 {
+    evy = std::min(evy, 16);
+
+    u16 result = 0;
+
+    for (int shift = 0; shift < 15; shift += 5) {
+      int channel = (target >> shift) & 31;
+
+      if (darken) {
+        channel -= (channel * evy) >> 4;
+      } else {
+        channel += ((31 - channel) * evy) >> 4;
+      }
+      result |= channel << shift;
+    }
+    return result;
+  };
+
+  for (int x = 0; x < 256; x++) {
+    u16 layers = 0x3F;
+
+    if constexpr (window) {
+      if (input.win_active[0] && input.win[0][x]) {
+        layers = input.win_layers[0];
+      } else if (input.win_active[1] && input.win[1][x]) {
+        layers = input.win_layers[1];
+      } else if (input.win_active[2] && input.obj_window[x]) {
+        layers = input.win_layers[2];
+      } else {
+        layers = input.win_layers[3];
+      }
+    }
+
+    bool obj_visible = (layers & ComposerInput::LAYER_OBJ) && input.enable_obj && input.obj_color[x] != kColorTransparent;
+
+    int prio[2] {4, 4};
+    int layer[2] {kLayerBD, kLayerBD};
+    bool is_alpha_obj = false;
+
+    // Find the two top-most visible layers.
+    for (int i = 0; i < input.bg_count; i++) {
+      int bg = input.bg_list[i];
+
+      if ((layers & (1 << bg)) && input.bg[bg][x] != kColorTransparent) {
+        layer[1] = layer[0];
+        layer[0] = bg;
+        prio[1] = prio[0];
+        prio[0] = input.bg_priority[bg];
+      }
+    }
+
+    if (obj_visible) {
+      if (input.obj_priority[x] <= prio[0]) {
+        layer[1] = layer[0];
+        layer[0] = kLayerOBJ;
+        is_alpha_obj = input.obj_alpha[x];
+      } else if (input.obj_priority[x] <= prio[1]) {
+        layer[1] = kLayerOBJ;
+      }
+    }
+
+    u16 pixel[2];
+
+    for (int i = 0; i < 2; i++) {
+      switch (layer[i]) {
+        case kLayerOBJ: pixel[i] = input.obj_color[x]; break;
+        case kLayerBD:  pixel[i] = input.backdrop; break;
+        default:        pixel[i] = input.bg[layer[i]][x]; break;
+      }
+    }
+
+    if constexpr (blending) {
+      bool sfx_enable = layers & ComposerInput::LAYER_SFX;
+      bool have_dst = input.targets[0] & (1 << layer[0]);
+      bool have_src = input.targets[1] & (1 << layer[1]);
+
+      if (is_alpha_obj && have_src) {
+        pixel[0] = blend(pixel[0], pixel[1], input.eva, input.evb);
+      }
+
+      switch (input.sfx) {
+        case ComposerInput::SFX_BLEND: {
+          if (layer[0] == 0 && input.alpha_3d != nullptr && have_src) {
+            int alpha = input.alpha_3d[x];
+
+            pixel[0] = blend(pixel[0], pixel[1], alpha, 16 - alpha);
+          } else if (have_dst && have_src && sfx_enable) {
+            pixel[0] = blend(pixel[0], pixel[1], input.eva, input.evb);
+          }
+          break;
+        }
+        case ComposerInput::SFX_BRIGHTEN:
+        case ComposerInput::SFX_DARKEN: {
+          if (have_dst && sfx_enable) {
+            pixel[0] = brighten(pixel[0], input.evy, input.sfx == ComposerInput::SFX_DARKEN);
+          }
+          break;
+        }
+        default: {
+          break;
+        }
+      }
+    }
+
+    output[x] = pixel[0] | 0x8000;
+  }
+}
+
+inline void ComposeScanlineReference(u16* output, ComposerInput const& input) {
+  switch ((input.window ? 1 : 0) | (input.blending ? 2 : 0)) {
+    case 0b00: ComposeScanlineReference<false, false>(output, input); break;
+    case 0b01: ComposeScanlineReference<true,  false>(output, input); break;
+    case 0b10: ComposeScanlineReference<false, true >(output, input); break;
+    case 0b11: ComposeScanlineReference<true,  true >(output, input); break;
+  }
+}
+
+// Layer buffers and registers of a random scanline, prepared the same way as PPU::ComposeScanlineKernel() does.
+struct RandomScanline {
+  RandomScanline(Random& rng, ComposerInput::Effect sfx, bool window, bool bg0_3d) {
+    auto pixel = [&]() -> u16 {
+      return rng.OneIn(4) ? 0x8000 : (u16)(rng() & 0x7FFF);
+    };
+
+    bool enable_bg[4];
+
+    for (int bg = 0; bg < 4; bg++) {
+      rng.Fill(bg_line[bg], 256, pixel);
+      input.bg[bg] = bg_line[bg];
+      input.bg_priority[bg] = rng() % 4;
+      enable_bg[bg] = !rng.OneIn(4);
+    }
+
+    rng.Fill(obj_color, 256, pixel);
+    rng.Fill(obj_priority, 256, [&]() { return rng() % 4; });
+    rng.Fill(obj_alpha, 256, [&]() { return rng.OneIn(4); });
+    rng.Fill(obj_window, 256, [&]() { return rng.OneIn(2); });
+    rng.Fill(win[0], 256, [&]() { return rng.OneIn(2); });
+    rng.Fill(win[1], 256, [&]() { return rng.OneIn(2); });
+    rng.Fill(alpha_3d, 256, [&]() { return rng() % 17; });
+
+    input.obj_color = obj_color;
+    input.obj_priority = obj_priority;
+    input.obj_alpha = obj_alpha;
+    input.obj_window = obj_window;
+    input.win[0] = win[0];
+    input.win[1] = win[1];
+
+    // The PPU only passes the 3D alpha if BG0 is enabled and 3D.
+    if (bg0_3d) {
+      enable_bg[0] = true;
+      input.alpha_3d = alpha_3d;
+    } else {
+      input.alpha_3d = nullptr;
+    }
+
+    // Sort enabled backgrounds by their respective priority in ascending order.
+    input.bg_count = 0;
+
+    for (int prio = 3; prio >= 0; prio--) {
+      for (int bg = 3; bg >= 0; bg--) {
+        if (enable_bg[bg] && input.bg_priority[bg] == prio) {
+          input.bg_list[input.bg_count++] = bg;
+        }
+      }
+    }
+
+    input.enable_obj = !rng.OneIn(4);
+    input.backdrop = rng() & 0x7FFF;
+
+    input.window = window;
+    input.win_active[0] = window && rng.OneIn(2);
+    input.win_active[1] = window && rng.OneIn(2);
+    input.win_active[2] = window && rng.OneIn(2);
+
+    for (auto& layers : input.win_layers) {
+      layers = rng() & 0x3F;
+    }
+
+    // Semi-transparent OBJs need blending, even if no color special effect is selected.
+    input.blending = sfx != ComposerInput::SFX_NONE || !rng.OneIn(2);
+    input.sfx = sfx;
+    input.targets[0] = rng() & 0x3F;
+    input.targets[1] = rng() & 0x3F;
+    input.eva = rng() % 32;
+    input.evb = rng() % 32;
+    input.evy = rng() % 32;
+  }
+
+  ComposerInput input;
+  u16 bg_line[4][256];
+  u16 obj_color[256];
+  u8 obj_priority[256];
+  bool obj_alpha[256];
+  bool obj_window[256];
+  bool win[2][256];
+  u8 alpha_3d[256];
+};
+
+} // namespace lunar::test
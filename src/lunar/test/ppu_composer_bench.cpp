@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ppu_composer.hpp"
+
+using namespace lunar;
+using namespace lunar::nds;
+
+// Measures the time per composed scanline of the reference compositor and of the compositor kernels, per color special effect.
+
+int main() {
+  static constexpr int kScanlines = 64;
+  static char const* const sfx_names[] { "none", "blend", "brighten", "darken" };
+
+  auto rng = test::Random{0xC0FF};
+
+  u16 output[256];
+
+  for (int sfx = 0; sfx < 4; sfx++) {
+    std::vector<std::unique_ptr<test::RandomScanline>> scanlines;
+
+    // Half of the scanlines use windows and the 3D BG0 layer.
+    for (int line = 0; line < kScanlines; line++) {
+      scanlines.push_back(std::make_unique<test::RandomScanline>(rng, (ComposerInput::Effect)sfx, line % 4 >= 2, line % 2));
+    }
+
+    test::Measure(std::string{"reference "} + sfx_names[sfx], 2000, kScanlines, [&]() {
+      for (auto& scanline : scanlines) test::ComposeScanlineReference(output, scanline->input);
+    });
+
+    for (auto [name, kernels] : test::GetPPUKernelSets()) {
+      if (kernels->compose_scanline != nullptr) {
+        test::Measure(std::string{name} + " " + sfx_names[sfx], 2000, kScanlines, [&]() {
+          for (auto& scanline : scanlines) kernels->compose_scanline(output, scanline->input);
+        });
+      }
+    }
+  }
+
+  return 0;
+}
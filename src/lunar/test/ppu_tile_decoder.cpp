@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <string>
+
+#include "common.hpp"
+
+using namespace lunar;
+using namespace lunar::nds;
+
+/* Checks that the SIMD tile decoders return exactly the same pixels as the scalar decoders,
+ * for both flip directions and for PRAM as well as extended palettes.
+ */
+
+int main() {
+  auto rng = test::Random{0x7113};
+  auto const& scalar = g_ppu_kernels_scalar;
+  auto kernel_sets = test::GetPPUKernelSets();
+
+  u16 palette[256];
+
+  for (int i = 0; i < 100000; i++) {
+    rng.Fill(palette, 256, [&]() { return (u16)rng(); });
+
+    // Tile data with a mix of transparent and opaque pixels.
+    u64 data = rng.Next64();
+
+    if (rng.OneIn(4)) data = 0;
+    if (rng.OneIn(4)) data &= rng.Next64();
+
+    for (auto [name, kernels] : kernel_sets) {
+      if (kernels == &scalar) {
+        continue;
+      }
+
+      for (bool flip : {false, true}) {
+        u16 expected[8];
+        u16 actual[8];
+
+        scalar.decode_tile_line_4bpp(expected, (u32)data, palette, flip);
+        kernels->decode_tile_line_4bpp(actual, (u32)data, palette, flip);
+
+        if (!test::ExpectEqual((std::string{name} + " 4bpp").c_str(), expected, actual, 8)) {
+          return 1;
+        }
+
+        for (u16 color_mask : {0x7FFF, 0xFFFF}) {
+          scalar.decode_tile_line_8bpp(expected, data, palette, color_mask, flip);
+          kernels->decode_tile_line_8bpp(actual, data, palette, color_mask, flip);
+
+          if (!test::ExpectEqual((std::string{name} + " 8bpp").c_str(), expected, actual, 8)) {
+            return 1;
+          }
+        }
+      }
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2022 fleroviux.
+ *
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <string>
+
+#include "common.hpp"
+
+using namespace lunar;
+using namespace lunar::nds;
+
+// Measures the time per decoded tile row of the 4BPP and 8BPP tile decoders.
+
+int main() {
+  static constexpr int kRows = 4096;
+
+  static u64 data[kRows];
+  static u16 palette[256];
+  static u16 buffer[kRows][8];
+
+  auto rng = test::Random{0x7113};
+
+  rng.Fill(data, kRows, [&]() { return rng.Next64(); });
+  rng.Fill(palette, 256, [&]() { return (u16)rng(); });
+
+  for (auto [name, kernels] : test::GetPPUKernelSets()) {
+    test::Measure(std::string{name} + " 4bpp", 2000, kRows, [&]() {
+      for (int i = 0; i < kRows; i++) kernels->decode_tile_line_4bpp(buffer[i], (u32)data[i], palette, i & 1);
+    });
+
+    test::Measure(std::string{name} + " 8bpp", 2000, kRows, [&]() {
+      for (int i = 0; i < kRows; i++) kernels->decode_tile_line_8bpp(buffer[i], data[i], palette, 0x7FFF, i & 1);
+    });
+
+    test::Measure(std::string{name} + " 8bpp extpal", 2000, kRows, [&]() {
+      for (int i = 0; i < kRows; i++) kernels->decode_tile_line_8bpp(buffer[i], data[i], palette, 0xFFFF, i & 1);
+    });
+  }
+
+  return 0;
+}
@@ -25,15 +25,30 @@ struct OGLVideoDevice final : VideoDevice {
     void const* bottom_image
   ) override;
 
+  auto AcquireFrameBuffer(Screen screen) -> void* override;
+
   void Present();
 
 private:
+  static constexpr size_t kFrameBufferSize = 256 * 192 * sizeof(u32);
+
+  // Pixel buffer object that a frame is rendered to while it is mapped.
+  struct FrameBuffer {
+    GLuint pbo;
+    void* mapping = nullptr;
+  };
+
+  void UploadImage(Screen screen, ImageType type, void const*& image);
+
   SDL_Window* window;
   void const* top_image = nullptr;
   void const* bottom_image = nullptr;
   ImageType top_image_type = ImageType::Software;
   ImageType bottom_image_type = ImageType::Software;
   GLuint textures[2];
+
+  FrameBuffer frame_buffers[2][3]; //< Three per screen: one that is rendered to, one that waits to be presented and one that is presented
+  int next_frame_buffer[2] {};
 };
 
 } // namespace lunar
\ No newline at end of file
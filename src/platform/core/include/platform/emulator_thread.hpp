@@ -8,14 +8,33 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <functional>
 #include <lunar/core.hpp>
+#include <mutex>
+#include <optional>
 #include <platform/frame_limiter.hpp>
 #include <thread> 
 
 namespace lunar {
 
 struct EmulatorThread {
+  /* Frames that are skipped while fast-forwarding. Skipped frames are emulated exactly, but not rendered or presented.
+   * Fixed: `frames` frames are skipped after each rendered frame.
+   * Adaptive: up to `frames` frames are skipped, as few as possible to reach `target_speed` (a multiple of real-time speed).
+   */
+  struct FrameSkip {
+    enum class Mode {
+      Disabled,
+      Fixed,
+      Adaptive
+    };
+
+    Mode mode = Mode::Disabled;
+    int frames = 0;
+    float target_speed = 1.0;
+  };
+
   EmulatorThread(std::unique_ptr<CoreBase>& core);
  ~EmulatorThread();
 
@@ -24,12 +43,18 @@ struct EmulatorThread {
   void SetPause(bool value);
   bool GetFastForward() const;
   void SetFastForward(bool enabled);
+  void SetFrameSkip(FrameSkip const& frame_skip);
   void SetFrameRateCallback(std::function<void(float)> callback);
   void SetPerFrameCallback(std::function<void()> callback);
   void Start();
   void Stop();
 
 private:
+  static constexpr float kFrameRate = 59.7275;
+
+  bool SkipNextFrame();
+  void UpdateAdaptiveFrameSkip();
+
   std::unique_ptr<CoreBase>& core;
   FrameLimiter frame_limiter;
   std::thread thread;
@@ -37,6 +62,13 @@ private:
   bool paused = false;
   std::function<void(float)> frame_rate_cb = [](float) {};
   std::function<void()> per_frame_cb = []() {};
+
+  FrameSkip frame_skip;
+  std::optional<FrameSkip> frame_skip_pending; //< Frame skip policy set by SetFrameSkip(), applied by the emulator thread
+  std::mutex frame_skip_mutex;
+  int frames_to_skip = 0; //< Number of frames to skip after each rendered frame
+  int frames_skipped = 0; //< Number of frames skipped since the last rendered frame
+  std::chrono::time_point<std::chrono::steady_clock> timestamp_rendered; //< Start of the last rendered frame
 };
 
 } // namespace lunar
\ No newline at end of file
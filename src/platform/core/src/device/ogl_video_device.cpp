@@ -22,17 +22,59 @@ OGLVideoDevice::OGLVideoDevice(SDL_Window* window) : window(window) {
 
   for (int i = 0; i < 2; i++) {
     glBindTexture(GL_TEXTURE_2D, textures[i]);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 256, 192, 0, GL_BGRA, GL_UNSIGNED_BYTE, nullptr);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    for (auto& frame_buffer : frame_buffers[i]) {
+      glGenBuffers(1, &frame_buffer.pbo);
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, frame_buffer.pbo);
+      glBufferData(GL_PIXEL_UNPACK_BUFFER, kFrameBufferSize, nullptr, GL_STREAM_DRAW);
+    }
   }
 
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
   glClearColor(0, 0, 0, 1);
 }
 
 OGLVideoDevice::~OGLVideoDevice() {
+  for (auto& screen_frame_buffers : frame_buffers) {
+    for (auto& frame_buffer : screen_frame_buffers) {
+      if (frame_buffer.mapping != nullptr) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, frame_buffer.pbo);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+      }
+      glDeleteBuffers(1, &frame_buffer.pbo);
+    }
+  }
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
   glDeleteTextures(2, &textures[0]);
 }
 
+auto OGLVideoDevice::AcquireFrameBuffer(Screen screen) -> void* {
+  auto& frame_buffer = frame_buffers[screen][next_frame_buffer[screen]];
+
+  next_frame_buffer[screen] = (next_frame_buffer[screen] + 1) % 3;
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, frame_buffer.pbo);
+
+  if (frame_buffer.mapping != nullptr) {
+    // The frame in this buffer has not been presented in time, drop it.
+    if (top_image == frame_buffer.mapping) top_image = nullptr;
+    if (bottom_image == frame_buffer.mapping) bottom_image = nullptr;
+
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+  }
+
+  // The emulator renders directly into the mapped buffer, the frame is then uploaded from it without another copy.
+  frame_buffer.mapping = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, kFrameBufferSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  return frame_buffer.mapping;
+}
+
 void OGLVideoDevice::Draw(
   ImageType top_image_type,
   void const* top_image,
@@ -54,15 +96,7 @@ void OGLVideoDevice::Present() {
 
   glActiveTexture(GL_TEXTURE0);
 
-  if(top_image_type == ImageType::Software) {
-    glBindTexture(GL_TEXTURE_2D, textures[0]);
-
-    if(top_image != nullptr) {
-      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 256, 192, 0, GL_BGRA, GL_UNSIGNED_BYTE, top_image);
-    }
-  } else {
-    glBindTexture(GL_TEXTURE_2D, (GLuint)(std::uintptr_t)top_image);
-  }
+  UploadImage(Screen::Top, top_image_type, top_image);
 
   glBegin(GL_QUADS);
   glTexCoord2f(0.0f, 0.0f);
@@ -75,15 +109,7 @@ void OGLVideoDevice::Present() {
   glVertex2f(-1.0f,  0.0f);
   glEnd();
 
-  if(bottom_image_type == ImageType::Software) {
-    glBindTexture(GL_TEXTURE_2D, textures[1]);
-
-    if(bottom_image != nullptr) {
-      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 256, 192, 0, GL_BGRA, GL_UNSIGNED_BYTE, bottom_image);
-    }
-  } else {
-    glBindTexture(GL_TEXTURE_2D, (GLuint)(std::uintptr_t)bottom_image);
-  }
+  UploadImage(Screen::Bottom, bottom_image_type, bottom_image);
 
   glBegin(GL_QUADS);
   glTexCoord2f(0.0f, 0.0f);
@@ -99,4 +125,33 @@ void OGLVideoDevice::Present() {
   SDL_GL_SwapWindow(window);
 }
 
+void OGLVideoDevice::UploadImage(Screen screen, ImageType type, void const*& image) {
+  if(type != ImageType::Software) {
+    glBindTexture(GL_TEXTURE_2D, (GLuint)(std::uintptr_t)image);
+    return;
+  }
+
+  glBindTexture(GL_TEXTURE_2D, textures[screen]);
+
+  if(image == nullptr) {
+    return;
+  }
+
+  for(auto& frame_buffer : frame_buffers[screen]) {
+    if(frame_buffer.mapping == image) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, frame_buffer.pbo);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 256, 192, GL_BGRA, GL_UNSIGNED_BYTE, nullptr);
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      frame_buffer.mapping = nullptr;
+
+      // The texture now holds the frame, do not upload it again.
+      image = nullptr;
+      return;
+    }
+  }
+
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 256, 192, GL_BGRA, GL_UNSIGNED_BYTE, image);
+}
+
 } // namespace lunar
\ No newline at end of file
@@ -5,6 +5,7 @@
  * found in the LICENSE file.
  */
 
+#include <algorithm>
 #include <platform/emulator_thread.hpp>
 
 namespace lunar {
@@ -12,7 +13,7 @@ namespace lunar {
 EmulatorThread::EmulatorThread(
   std::unique_ptr<CoreBase>& core
 )   : core(core) {
-  frame_limiter.Reset(59.7275);
+  frame_limiter.Reset(kFrameRate);
 }
 
 EmulatorThread::~EmulatorThread() {
@@ -39,6 +40,11 @@ void EmulatorThread::SetFastForward(bool enabled) {
   frame_limiter.SetFastForward(enabled);
 }
 
+void EmulatorThread::SetFrameSkip(FrameSkip const& frame_skip) {
+  std::lock_guard lock{frame_skip_mutex};
+  frame_skip_pending = frame_skip;
+}
+
 void EmulatorThread::SetFrameRateCallback(std::function<void(float)> callback) {
   frame_rate_cb = callback;
 }
@@ -57,6 +63,7 @@ void EmulatorThread::Start() {
         frame_limiter.Run([this]() {
           if (!paused) {
             per_frame_cb();
+            core->SetSkipRendering(SkipNextFrame());
             core->Run(559241);
           }
         }, [this](float fps) {
@@ -70,6 +77,56 @@ void EmulatorThread::Start() {
   }
 }
 
+bool EmulatorThread::SkipNextFrame() {
+  {
+    std::lock_guard lock{frame_skip_mutex};
+
+    if (frame_skip_pending.has_value()) {
+      frame_skip = frame_skip_pending.value();
+      frames_to_skip = frame_skip.mode == FrameSkip::Mode::Fixed ? frame_skip.frames : 0;
+      frames_skipped = 0;
+      frame_skip_pending.reset();
+    }
+  }
+
+  if (!frame_limiter.GetFastForward() || frame_skip.mode == FrameSkip::Mode::Disabled) {
+    frames_skipped = 0;
+    timestamp_rendered = std::chrono::steady_clock::now();
+    return false;
+  }
+
+  if (frames_skipped < frames_to_skip) {
+    frames_skipped++;
+    return true;
+  }
+
+  if (frame_skip.mode == FrameSkip::Mode::Adaptive) {
+    UpdateAdaptiveFrameSkip();
+  }
+
+  frames_skipped = 0;
+  return false;
+}
+
+void EmulatorThread::UpdateAdaptiveFrameSkip() {
+  auto now = std::chrono::steady_clock::now();
+  auto elapsed = std::chrono::duration<float>(now - timestamp_rendered).count();
+
+  timestamp_rendered = now;
+
+  // Speed of the last rendered frame and the frames skipped after it, relative to real-time.
+  auto speed = (frames_skipped + 1) / (elapsed * kFrameRate);
+
+  /* Skipping one frame less at most reduces the speed by a factor of skipped / (skipped + 1),
+   * which is the case if skipped frames take no time at all.
+   */
+  if (speed < frame_skip.target_speed) {
+    frames_to_skip = std::min(frames_to_skip + 1, frame_skip.frames);
+  } else if (frames_skipped > 0 && speed * frames_skipped / (frames_skipped + 1) >= frame_skip.target_speed) {
+    frames_to_skip--;
+  }
+}
+
 void EmulatorThread::Stop() {
   if (IsRunning()) {
     running = false;